@@ -0,0 +1,75 @@
+#!/bin/sh
+# Compile time benchmark: how long translation units take to compile when they include
+#   full    parse_options.hpp and add options of common types
+#   extern  the same, linking with parse_options_lib so the common instantiations are not repeated
+#   slim    only parse_options_fwd.hpp, as a header shared by many translation units would
+#
+# usage: bench_compile.sh [compiler] [translation units per variant] [flags]
+
+CXX=${1:-${CXX:-c++}}
+NUM_TUS=${2:-20}
+FLAGS=${3:--O2}
+SOURCE_DIR=$(cd "$(dirname "$0")" && pwd)
+WORK_DIR=$(mktemp -d)
+
+trap 'rm -rf "$WORK_DIR"' EXIT
+
+cat > "$WORK_DIR/full.cpp" <<'TU'
+#include "parse_options.hpp"
+
+struct Settings
+{
+  int threads{1};
+  long memory{0};
+  double ratio{0.5};
+  std::string name;
+  bool verbose{false};
+};
+
+void add_options( parse_options::OptionParser& parser, Settings& settings )
+{
+  parser.add( "threads", "Worker threads", &settings.threads );
+  parser.add( "memory", "Memory limit", &settings.memory );
+  parser.add( "ratio", "A ratio", &settings.ratio );
+  parser.add( "name", "A name", &settings.name );
+  parser.add( "verbose", "Print more", &settings.verbose );
+}
+TU
+
+cat > "$WORK_DIR/slim.cpp" <<'TU'
+#include <string>
+
+#include "parse_options_fwd.hpp"
+
+struct Settings
+{
+  int threads{1};
+  long memory{0};
+  double ratio{0.5};
+  std::string name;
+  bool verbose{false};
+};
+
+void add_options( parse_options::OptionParser& parser, Settings& settings );
+
+int threads_of( const Settings& settings ) { return settings.threads; }
+TU
+
+# compile the variant NUM_TUS times and print the seconds it took
+
+time_variant()
+{
+  start=$(date +%s.%N)
+
+  for ii in $(seq "$NUM_TUS"); do
+    "$CXX" -std=c++17 $FLAGS $2 -I"$SOURCE_DIR" -c "$WORK_DIR/$1.cpp" -o "$WORK_DIR/$1.o" || exit 1
+  done
+
+  end=$(date +%s.%N)
+  echo "$start $end" | awk -v name="$3" -v n="$NUM_TUS" '{ printf "  %-8s %8.3f s/translation unit\n", name, ($2 - $1) / n }'
+}
+
+echo "$CXX $FLAGS, $NUM_TUS translation units per variant:"
+time_variant full "" full
+time_variant full "-DPARSE_OPTIONS_EXTERN_TEMPLATES" extern
+time_variant slim "" slim
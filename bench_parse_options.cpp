@@ -0,0 +1,445 @@
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "parse_options.hpp"
+#include "parse_options_cache.hpp"
+#include "parse_options_completion.hpp"
+
+// Micro benchmarks for the option parser.  Each benchmark reports the mean time per operation.
+
+/* ----------------------------------------------------------------------------
+ * time_per_op
+---------------------------------------------------------------------------- */
+template<typename F>
+double time_per_op( int iterations, F&& operation )
+{
+  auto start = std::chrono::steady_clock::now();
+
+  for( int ii = 0; ii < iterations; ii += 1 )
+    {
+      operation();
+    }
+
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+  return elapsed.count() / iterations;
+}
+
+/* ----------------------------------------------------------------------------
+ * report
+---------------------------------------------------------------------------- */
+void report( const std::string_view& name, double ns_per_op )
+{
+  std::cout << "  " << name;
+
+  if( name.size() < 40 )
+    {
+      std::cout << std::string( 40 - name.size(), ' ' );
+    }
+
+  std::cout << ns_per_op << " ns/op\n";
+}
+
+// Keep the optimizer from discarding the results of a benchmark
+
+static std::size_t sink = 0;
+
+/* ----------------------------------------------------------------------------
+ * Error message formatting
+---------------------------------------------------------------------------- */
+class ErrorFormatter : public parse_options::ValueOption<int>
+{
+  public:
+    ErrorFormatter() : parse_options::ValueOption<int>( "real_long_option_name", "", nullptr ) {}
+
+    // The stream based formatting the option records used before
+    std::string stream_message( const std::string_view& err_str, const std::string_view& value ) const
+    {
+      std::ostringstream fmt;
+      fmt << "Error: " << err_str << "\n";
+      fmt << "  parameter: " << name_;
+
+      if( not value.empty())
+        {
+          fmt << "  value: \"" << value << "\"\n";
+        }
+
+      return fmt.str();
+    }
+
+    std::string buffer_message( const std::string_view& err_str, const std::string_view& value ) const
+    {
+      return error_message( err_str, value );
+    }
+};
+
+void bench_error_message()
+{
+  const int iterations = 1000000;
+  ErrorFormatter formatter;
+
+  std::cout << "error_message:\n";
+
+  report( "ostringstream", time_per_op( iterations, [&]() {
+    sink += formatter.stream_message( "parsing parameter failed", "not_a_number" ).size();
+  } ));
+
+  report( "pre-sized buffer", time_per_op( iterations, [&]() {
+    sink += formatter.buffer_message( "parsing parameter failed", "not_a_number" ).size();
+  } ));
+}
+
+/* ----------------------------------------------------------------------------
+ * Parsing with and without a cache
+---------------------------------------------------------------------------- */
+struct benchOptions
+{
+  bool verbose{false};
+  int integer{0};
+  double real{0.};
+  std::string name;
+};
+
+void add_options( parse_options::OptionParser& parser, benchOptions& options )
+{
+  parser.add( "verbose", "Print semi-useful stuff", &options.verbose );
+  parser.add( "integer", "An integer", &options.integer );
+  parser.add( "real", "A floating point number", &options.real );
+  parser.add( "name", "A string", &options.name );
+}
+
+void bench_parse_cache()
+{
+  const int iterations = 200000;
+  const char* argv[] = { "program", "--verbose", "--integer", "42", "--real", "2.5", "--name", "value",
+                         "input_file", "output_file" };
+  const int argc = sizeof( argv ) / sizeof( argv[0] );
+
+  parse_options::ParseCache cache( 1024 );
+
+  std::cout << "parse:\n";
+
+  report( "uncached", time_per_op( iterations, [&]() {
+    benchOptions options;
+    parse_options::OptionParser parser;
+    add_options( parser, options );
+
+    parser.parse( argc, argv );
+    sink += options.integer;
+  } ));
+
+  report( "cached", time_per_op( iterations, [&]() {
+    benchOptions options;
+    parse_options::OptionParser parser;
+    add_options( parser, options );
+
+    parser.parse( argc, argv, cache );
+    sink += options.integer;
+  } ));
+}
+
+/* ----------------------------------------------------------------------------
+ * Converting a user type with operator>> and with a value_converter
+---------------------------------------------------------------------------- */
+struct StreamAddress
+{
+  unsigned char octets[4]{};
+};
+
+std::istream& operator>>( std::istream& is, StreamAddress& address )
+{
+  for( int ii = 0; ii < 4; ii += 1 )
+    {
+      unsigned octet = 0;
+      char dot = '.';
+
+      if( ii )
+        {
+          is >> dot;
+        }
+
+      if( not (is >> octet) or dot != '.' or 255 < octet )
+        {
+          is.setstate( std::ios::failbit );
+          break;
+        }
+
+      address.octets[ii] = static_cast<unsigned char>( octet );
+    }
+
+  return is;
+}
+
+std::ostream& operator<<( std::ostream& os, const StreamAddress& address )
+{
+  return os << int( address.octets[0] ) << '.' << int( address.octets[1] ) << '.' << int( address.octets[2] )
+            << '.' << int( address.octets[3] );
+}
+
+struct ConvertedAddress
+{
+  unsigned char octets[4]{};
+};
+
+template<>
+struct parse_options::value_converter<ConvertedAddress>
+{
+  static std::errc parse( std::string_view text, ConvertedAddress& address )
+  {
+    const char* pos = text.data();
+    const char* end = text.data() + text.size();
+
+    for( int ii = 0; ii < 4; ii += 1 )
+      {
+        unsigned octet = 0;
+
+        if( ii and (pos == end or *pos++ != '.'))
+          {
+            return std::errc::invalid_argument;
+          }
+
+        auto result = std::from_chars( pos, end, octet );
+
+        if( result.ec != std::errc() or 255 < octet )
+          {
+            return result.ec != std::errc() ? result.ec : std::errc::result_out_of_range;
+          }
+
+        address.octets[ii] = static_cast<unsigned char>( octet );
+        pos = result.ptr;
+      }
+
+    return pos == end ? std::errc() : std::errc::invalid_argument;
+  }
+
+  static void format( const ConvertedAddress& address, std::pmr::string& out )
+  {
+    for( int ii = 0; ii < 4; ii += 1 )
+      {
+        char buffer[4];
+        auto result = std::to_chars( buffer, buffer + sizeof( buffer ), unsigned( address.octets[ii] ));
+
+        if( ii )
+          {
+            out.push_back( '.' );
+          }
+
+        out.append( buffer, result.ptr );
+      }
+  }
+};
+
+void bench_value_converter()
+{
+  const int iterations = 1000000;
+
+  StreamAddress stream_address;
+  ConvertedAddress converted_address;
+  parse_options::ValueOption<StreamAddress> stream_option( "address", "", &stream_address );
+  parse_options::ValueOption<ConvertedAddress> converted_option( "address", "", &converted_address );
+
+  std::cout << "user type conversion:\n";
+
+  report( "operator>>", time_per_op( iterations, [&]() {
+    stream_option.parse( "192.168.100.254" );
+    sink += stream_address.octets[3];
+  } ));
+
+  report( "value_converter", time_per_op( iterations, [&]() {
+    converted_option.parse( "192.168.100.254" );
+    sink += converted_address.octets[3];
+  } ));
+}
+
+/* ----------------------------------------------------------------------------
+ * Streaming arguments from a pipe
+---------------------------------------------------------------------------- */
+#if defined( PARSE_OPTIONS_HAS_POSIX )
+void bench_parse_stream( std::size_t num_mb )
+{
+  int fds[2];
+
+  if( pipe( fds ) != 0 )
+    {
+      return;
+    }
+
+  // A writer thread generates NUL separated paths, with an option every so often
+
+  const std::size_t total = num_mb * 1024 * 1024;
+
+  std::thread writer( [&]() {
+    std::string block;
+
+    for( int ii = 0; block.size() < 1024 * 1024; ii += 1 )
+      {
+        if( ii % 100 == 0 )
+          {
+            block.append( "--integer" );
+            block.push_back( '\0' );
+            block.append( std::to_string( ii ));
+          }
+        else
+          {
+            block.append( "some/directory/and/a/file_" );
+            block.append( std::to_string( ii ));
+          }
+
+        block.push_back( '\0' );
+      }
+
+    for( std::size_t written = 0; written < total; written += block.size())
+      {
+        for( std::size_t pos = 0; pos < block.size(); )
+          {
+            ssize_t num_written = write( fds[1], block.data() + pos, block.size() - pos );
+
+            if( num_written <= 0 )
+              {
+                break;
+              }
+
+            pos += num_written;
+          }
+      }
+
+    close( fds[1] );
+  } );
+
+  benchOptions options;
+  parse_options::OptionParser parser;
+  add_options( parser, options );
+
+  std::size_t num_positionals = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  parser.parse_stream( fds[0], [&]( std::string_view one ) { num_positionals += 1; sink += one.size(); } );
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  writer.join();
+  close( fds[0] );
+
+  std::cout << "parse_stream:\n";
+  std::cout << "  " << num_mb << " MB, " << num_positionals << " arguments in " << elapsed.count() << " s, "
+            << num_mb / elapsed.count() << " MB/s, " << parser.last_parse_bytes() << " bytes allocated\n";
+}
+#endif
+
+/* ----------------------------------------------------------------------------
+ * Completion queries against a server, from several clients at once
+---------------------------------------------------------------------------- */
+#if defined( PARSE_OPTIONS_HAS_POSIX )
+void bench_completion_server( int num_clients, int num_queries )
+{
+  const int num_options = 2000;
+  std::vector<int> values( num_options );
+
+  parse_options::OptionParser parser;
+
+  for( int ii = 0; ii < num_options; ii += 1 )
+    {
+      std::string name = "option_" + std::to_string( ii );
+      parser.add( name, "An option", &values[ii] );
+    }
+
+  std::string path = "/tmp/bench_parse_options_" + std::to_string( getpid()) + ".sock";
+  parse_options::CompletionServer server( parser, path );
+  std::thread serving( [&]() { server.serve(); } );
+
+  // each client keeps its connection and alternates between option names and option values
+
+  std::vector<std::vector<double>> latencies( num_clients );
+  std::vector<std::thread> clients;
+
+  for( int cc = 0; cc < num_clients; cc += 1 )
+    {
+      clients.emplace_back( [&, cc]() {
+        parse_options::CompletionClient client( path );
+        std::vector<double>& latency = latencies[cc];
+        latency.reserve( num_queries );
+
+        for( int ii = 0; ii < num_queries; ii += 1 )
+          {
+            std::string word = "--option_" + std::to_string(( ii * 7 + cc ) % 200 );
+            auto start = std::chrono::steady_clock::now();
+
+            sink += ii % 2 ? client.query( word, "" ).size() : client.query( "program", word ).size();
+
+            std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+            latency.push_back( elapsed.count());
+          }
+      } );
+    }
+
+  for( auto& one : clients )
+    {
+      one.join();
+    }
+
+  server.stop();
+  serving.join();
+
+  std::vector<double> all;
+
+  for( const auto& one : latencies )
+    {
+      all.insert( all.end(), one.begin(), one.end());
+    }
+
+  std::sort( all.begin(), all.end());
+
+  auto percentile = [&]( double pp ) { return all[static_cast<std::size_t>( pp * ( all.size() - 1 ))]; };
+
+  std::cout << "completion server:\n";
+  std::cout << "  " << num_clients << " clients, " << all.size() << " queries, " << num_options << " options: p50 "
+            << percentile( 0.5 ) << " us, p99 " << percentile( 0.99 ) << " us, max " << all.back() << " us\n";
+}
+#endif
+
+/* ----------------------------------------------------------------------------
+ * main
+---------------------------------------------------------------------------- */
+int main( int argc, char* argv[] )
+{
+  struct
+  {
+    int stream_mb{2048};
+    int completion_clients{8};
+  } options;
+
+  parse_options::OptionParser parser( "Micro benchmarks for the option parser" );
+  parser.add( "stream_mb", "Megabytes of synthetic input for the parse_stream benchmark", &options.stream_mb );
+  parser.add( "completion_clients", "Concurrent clients of the completion server benchmark",
+              &options.completion_clients );
+
+  try
+    {
+      parser.parse( argc, argv );
+    }
+
+  catch( std::invalid_argument& e1 )
+    {
+      std::cerr << "# " << e1.what();
+      std::cerr << parser.usage();
+
+      return 1;
+    }
+
+  bench_error_message();
+  bench_parse_cache();
+  bench_value_converter();
+
+#if defined( PARSE_OPTIONS_HAS_POSIX )
+  bench_parse_stream( options.stream_mb );
+  bench_completion_server( options.completion_clients, 20000 );
+#endif
+
+  return sink == 0;
+}
@@ -0,0 +1,329 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "parse_options.hpp"
+
+// End to end startup benchmark.  With --generate it writes the source of a program with N registered
+// options of mixed types; otherwise it runs the programs it is given with fork/exec and a realistic
+// command line, and reports how long they take to start, split into exec, static initialization,
+// registration, parse and usage.  The programs report their own timestamps on CLOCK_MONOTONIC, which
+// is shared by every process, so the split needs no cooperation beyond printing them.  The first one
+// is taken by a constructor of priority 101, which runs before every C++ static initializer.
+
+/* ----------------------------------------------------------------------------
+ * monotonic_ns
+---------------------------------------------------------------------------- */
+long long monotonic_ns()
+{
+  timespec now;
+  clock_gettime( CLOCK_MONOTONIC, &now );
+
+  return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+// Option ii of a generated program has type types[ii % 4], and its name and values come from these
+
+const char* types[] = { "int", "double", "std::string", "bool" };
+
+std::string option_name( int ii )
+{
+  return "option_" + std::to_string( ii );
+}
+
+/* ----------------------------------------------------------------------------
+ * generate
+---------------------------------------------------------------------------- */
+bool generate( int num_options, const std::string& output )
+{
+  std::ofstream out( output );
+
+  out << "// Generated by bench_startup --generate " << num_options << "\n\n";
+  out << "#include <cstdio>\n#include <time.h>\n\n#include \"parse_options.hpp\"\n";
+  out << R"(
+static long long monotonic_ns()
+{
+  timespec now;
+  clock_gettime( CLOCK_MONOTONIC, &now );
+
+  return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+// the end of exec and the start of static initialization: priorities up to 100 are reserved, and
+// static initializers without one run after every constructor that has one
+
+static long long init_ns;
+
+__attribute__(( constructor( 101 ))) static void stamp_init()
+{
+  init_ns = monotonic_ns();
+}
+
+)";
+
+  // The options are members of structs of group_size options, each with its own constructor, because
+  // compilers take time more than linear in the size of a single static initialization function
+
+  const int group_size = 100;
+
+  for( int ii = 0; ii < num_options; ii += 1 )
+    {
+      const char* type = types[ii % 4];
+
+      if( ii % group_size == 0 )
+        {
+          out << "struct Group" << ii / group_size << "\n{\n";
+        }
+
+      out << "  parse_options::RegisteredOption<" << type << "> " << option_name( ii ) << "{ \""
+          << option_name( ii ) << "\", PARSE_OPTIONS_DESCRIPTION( \"Option number " << ii << ", of type " << type
+          << "\" ) };\n";
+
+      if( ii % group_size == group_size - 1 or ii + 1 == num_options )
+        {
+          out << "} static group" << ii / group_size << ";\n\n";
+        }
+    }
+
+  out << R"(
+int main( int argc, char* argv[] )
+{
+  long long main_ns = monotonic_ns();
+
+  parse_options::OptionParser parser( "A program with many options" );
+  parser.add_registered();
+
+  long long registered_ns = monotonic_ns();
+
+  parser.parse( argc, argv );
+
+  long long parsed_ns = monotonic_ns();
+
+  std::size_t usage_size = parser.usage().size();
+
+  long long usage_ns = monotonic_ns();
+
+)";
+  out << "  std::printf( \"" << num_options
+      << " %lld %lld %lld %lld %lld %zu\\n\", init_ns, main_ns, registered_ns, parsed_ns, usage_ns, usage_size );\n";
+  out << "\n  return 0;\n}\n";
+
+  return bool( out );
+}
+
+/* ----------------------------------------------------------------------------
+ * A run of a generated program
+---------------------------------------------------------------------------- */
+struct Sample
+{
+  int num_options{0};
+  double exec_us{0};      // from fork to the first static initializer
+  double init_us{0};      // static initialization, up to main
+  double register_us{0};
+  double parse_us{0};
+  double usage_us{0};
+  double total_us{0};     // from fork to the exit of the child
+};
+
+bool run( const std::string& binary, const std::vector<std::string>& args, Sample& sample )
+{
+  int fds[2];
+
+  if( pipe( fds ) != 0 )
+    {
+      return false;
+    }
+
+  std::vector<char*> argv;
+  argv.push_back( const_cast<char*>( binary.c_str()));
+
+  for( const auto& one : args )
+    {
+      argv.push_back( const_cast<char*>( one.c_str()));
+    }
+
+  argv.push_back( nullptr );
+
+  long long start_ns = monotonic_ns();
+  pid_t pid = fork();
+
+  if( pid < 0 )
+    {
+      close( fds[0] );
+      close( fds[1] );
+      return false;
+    }
+
+  if( pid == 0 )
+    {
+      dup2( fds[1], STDOUT_FILENO );
+      close( fds[0] );
+      close( fds[1] );
+      execv( binary.c_str(), argv.data());
+      _exit( 127 );
+    }
+
+  close( fds[1] );
+
+  char buffer[256];
+  ssize_t num_read = 0;
+
+  for( ssize_t got; num_read < ssize_t( sizeof( buffer ) - 1 )
+                    and (got = read( fds[0], buffer + num_read, sizeof( buffer ) - 1 - num_read )) > 0; )
+    {
+      num_read += got;
+    }
+
+  close( fds[0] );
+
+  int status = 0;
+  waitpid( pid, &status, 0 );
+
+  long long end_ns = monotonic_ns();
+  buffer[num_read] = '\0';
+
+  long long init_ns, main_ns, registered_ns, parsed_ns, usage_ns;
+  std::size_t usage_size;
+
+  if( not WIFEXITED( status ) or WEXITSTATUS( status ) != 0
+      or std::sscanf( buffer, "%d %lld %lld %lld %lld %lld %zu", &sample.num_options, &init_ns, &main_ns,
+                      &registered_ns, &parsed_ns, &usage_ns, &usage_size ) != 7 )
+    {
+      return false;
+    }
+
+  sample.exec_us = ( init_ns - start_ns ) / 1000.;
+  sample.init_us = ( main_ns - init_ns ) / 1000.;
+  sample.register_us = ( registered_ns - main_ns ) / 1000.;
+  sample.parse_us = ( parsed_ns - registered_ns ) / 1000.;
+  sample.usage_us = ( usage_ns - parsed_ns ) / 1000.;
+  sample.total_us = ( end_ns - start_ns ) / 1000.;
+
+  return true;
+}
+
+/* ----------------------------------------------------------------------------
+ * command_line
+ * Set num_set options spread over all of them, with values of their types, and add a few files
+---------------------------------------------------------------------------- */
+std::vector<std::string> command_line( int num_options, int num_set )
+{
+  std::vector<std::string> args;
+
+  for( int jj = 0; jj < num_set and jj < num_options; jj += 1 )
+    {
+      int ii = static_cast<int>( static_cast<long long>( jj ) * num_options / std::min( num_set, num_options ));
+
+      args.push_back( "--" + option_name( ii ));
+
+      switch( ii % 4 )
+        {
+          case 0: args.push_back( std::to_string( ii )); break;
+          case 1: args.push_back( std::to_string( ii ) + ".5" ); break;
+          case 2: args.push_back( "/some/path/to/file_" + std::to_string( ii )); break;
+          default: break;
+        }
+    }
+
+  args.push_back( "input_file.txt" );
+  args.push_back( "output_file.txt" );
+
+  return args;
+}
+
+/* ----------------------------------------------------------------------------
+ * report
+---------------------------------------------------------------------------- */
+void report( const char* name, std::vector<Sample>& samples, double Sample::*field )
+{
+  std::sort( samples.begin(), samples.end(), [field]( const Sample& lhs, const Sample& rhs ) {
+    return lhs.*field < rhs.*field;
+  } );
+
+  auto at = [&]( double pp ) { return samples[static_cast<std::size_t>( pp * ( samples.size() - 1 ))].*field; };
+
+  std::printf( "  %-10s  p50 %9.1f us  p90 %9.1f us  p99 %9.1f us  max %9.1f us\n", name, at( 0.5 ), at( 0.9 ),
+               at( 0.99 ), samples.back().*field );
+}
+
+/* ----------------------------------------------------------------------------
+ * main
+---------------------------------------------------------------------------- */
+int main( int argc, char* argv[] )
+{
+  struct
+  {
+    int generate{0};
+    std::string output;
+    int runs{200};
+    int num_set{20};
+  } options;
+
+  parse_options::OptionParser parser( "Startup benchmark: bench_startup [options] <generated programs>" );
+  parser.add( "generate", "Write the source of a program with this many options and exit", &options.generate );
+  parser.add( "output", "The source file --generate writes", &options.output );
+  parser.add( "runs", "Runs of each program", &options.runs );
+  parser.add( "num_set", "Options set on the command line of each run", &options.num_set );
+
+  try
+    {
+      parser.parse( argc, argv );
+    }
+
+  catch( std::invalid_argument& e1 )
+    {
+      std::cerr << "# " << e1.what();
+      std::cerr << parser.usage();
+
+      return 1;
+    }
+
+  if( options.generate )
+    {
+      return generate( options.generate, options.output ) ? 0 : 1;
+    }
+
+  for( const auto& binary : parser.non_option_args())
+    {
+      // the first run, without arguments, warms the page cache and tells the number of options
+
+      Sample probe;
+
+      if( not run( std::string( binary ), {}, probe ))
+        {
+          std::cerr << "# cannot run " << binary << "\n";
+          return 1;
+        }
+
+      std::vector<std::string> args = command_line( probe.num_options, options.num_set );
+      std::vector<Sample> samples( options.runs );
+
+      for( auto& one : samples )
+        {
+          if( not run( std::string( binary ), args, one ))
+            {
+              std::cerr << "# " << binary << " failed\n";
+              return 1;
+            }
+        }
+
+      std::printf( "%s: %d options, %zu arguments, %d runs\n", binary.c_str(), probe.num_options, args.size(),
+                   options.runs );
+
+      report( "exec", samples, &Sample::exec_us );
+      report( "init", samples, &Sample::init_us );
+      report( "register", samples, &Sample::register_us );
+      report( "parse", samples, &Sample::parse_us );
+      report( "usage", samples, &Sample::usage_us );
+      report( "total", samples, &Sample::total_us );
+    }
+
+  return 0;
+}
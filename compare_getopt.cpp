@@ -0,0 +1,464 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+
+#include "parse_options.hpp"
+
+// Differential comparison of OptionParser::parse and getopt_long.  Both parse the same randomized
+// command lines against equivalent schemas, restricted to what the two have in common: "--name value"
+// for options with a value, "--name" for switches, unique prefixes of names, and non-option arguments
+// anywhere.  The results and the errors have to agree; then the time and the allocations of each are
+// reported, for building the schema and for parsing apart, so the throughput compares the same work.
+// Nothing is read from the network or the file system.
+
+/* ----------------------------------------------------------------------------
+ * Count the allocations made by each parser
+---------------------------------------------------------------------------- */
+static std::size_t num_allocations = 0;
+
+static void* counted_allocate( std::size_t size, std::size_t alignment ) noexcept
+{
+  num_allocations += 1;
+  size = size ? size : 1;
+
+  if( alignment <= alignof( std::max_align_t ))
+    {
+      return std::malloc( size );
+    }
+
+  return std::aligned_alloc( alignment, (size + alignment - 1) / alignment * alignment );
+}
+
+// Out of line, or GCC sees free() called on what operator new returned and warns of a mismatch
+
+[[gnu::noinline]] static void counted_release( void* ptr ) noexcept { std::free( ptr ); }
+
+static void* counted_new( std::size_t size, std::size_t alignment )
+{
+  if( void* ptr = counted_allocate( size, alignment ))
+    {
+      return ptr;
+    }
+
+  throw std::bad_alloc();
+}
+
+// Every form is replaced, so that all of them go through the two functions above; the aligned ones
+// are what std::pmr::new_delete_resource calls
+
+void* operator new( std::size_t size ) { return counted_new( size, 0 ); }
+void* operator new[]( std::size_t size ) { return counted_new( size, 0 ); }
+void* operator new( std::size_t size, std::align_val_t align ) { return counted_new( size, std::size_t( align )); }
+void* operator new[]( std::size_t size, std::align_val_t align ) { return counted_new( size, std::size_t( align )); }
+
+void* operator new( std::size_t size, const std::nothrow_t& ) noexcept { return counted_allocate( size, 0 ); }
+void* operator new[]( std::size_t size, const std::nothrow_t& ) noexcept { return counted_allocate( size, 0 ); }
+
+void* operator new( std::size_t size, std::align_val_t align, const std::nothrow_t& ) noexcept
+{
+  return counted_allocate( size, std::size_t( align ));
+}
+
+void* operator new[]( std::size_t size, std::align_val_t align, const std::nothrow_t& ) noexcept
+{
+  return counted_allocate( size, std::size_t( align ));
+}
+
+void operator delete( void* ptr ) noexcept { counted_release( ptr ); }
+void operator delete[]( void* ptr ) noexcept { counted_release( ptr ); }
+void operator delete( void* ptr, std::size_t ) noexcept { counted_release( ptr ); }
+void operator delete[]( void* ptr, std::size_t ) noexcept { counted_release( ptr ); }
+void operator delete( void* ptr, std::align_val_t ) noexcept { counted_release( ptr ); }
+void operator delete[]( void* ptr, std::align_val_t ) noexcept { counted_release( ptr ); }
+void operator delete( void* ptr, std::size_t, std::align_val_t ) noexcept { counted_release( ptr ); }
+void operator delete[]( void* ptr, std::size_t, std::align_val_t ) noexcept { counted_release( ptr ); }
+void operator delete( void* ptr, const std::nothrow_t& ) noexcept { counted_release( ptr ); }
+void operator delete[]( void* ptr, const std::nothrow_t& ) noexcept { counted_release( ptr ); }
+void operator delete( void* ptr, std::align_val_t, const std::nothrow_t& ) noexcept { counted_release( ptr ); }
+void operator delete[]( void* ptr, std::align_val_t, const std::nothrow_t& ) noexcept { counted_release( ptr ); }
+
+/* ----------------------------------------------------------------------------
+ * A schema both parsers can take
+---------------------------------------------------------------------------- */
+struct Schema
+{
+  enum class Type { flag, integer, text };
+
+  struct Option
+  {
+    std::string name;
+    Type type;
+  };
+
+  std::vector<Option> options;
+};
+
+// What a command line set, which both parsers fill in the same form
+
+struct Result
+{
+  bool error{false};
+  std::vector<int> flags;
+  std::vector<int> integers;
+  std::vector<std::string> texts;
+  std::vector<std::string> positionals;
+
+  explicit Result( const Schema& schema ) :
+    flags( schema.options.size()), integers( schema.options.size()), texts( schema.options.size()) {}
+
+  bool operator==( const Result& other ) const
+  {
+    return error == other.error and (error or (flags == other.flags and integers == other.integers
+                                                and texts == other.texts and positionals == other.positionals));
+  }
+};
+
+/* ----------------------------------------------------------------------------
+ * random_schema
+ * Names are random lowercase words, none a prefix of another, since the two parsers do different
+ * things with a name that is a prefix of another: getopt_long prefers the exact match, OptionParser
+ * applies the argument to every option it starts.
+---------------------------------------------------------------------------- */
+Schema random_schema( std::mt19937& rng, int num_options )
+{
+  Schema schema;
+  std::uniform_int_distribution<int> letter( 'a', 'z' ), length( 3, 10 ), type( 0, 2 );
+
+  while( static_cast<int>( schema.options.size()) < num_options )
+    {
+      std::string name;
+
+      for( int ii = length( rng ); 0 < ii; ii -= 1 )
+        {
+          name.push_back( static_cast<char>( letter( rng )));
+        }
+
+      bool prefix = false;
+
+      for( const auto& one : schema.options )
+        {
+          prefix = prefix or one.name.compare( 0, name.size(), name ) == 0 or name.compare( 0, one.name.size(), one.name ) == 0;
+        }
+
+      if( not prefix )
+        {
+          schema.options.push_back( { name, static_cast<Schema::Type>( type( rng )) } );
+        }
+    }
+
+  return schema;
+}
+
+/* ----------------------------------------------------------------------------
+ * random_command_line
+ * Options by their full name or by a unique prefix, values of the right type, non-option arguments
+ * in between, and now and then an unknown option or a missing value
+---------------------------------------------------------------------------- */
+std::vector<std::string> random_command_line( std::mt19937& rng, const Schema& schema, int num_args )
+{
+  std::vector<std::string> args = { "program" };
+  std::uniform_int_distribution<int> pick( 0, static_cast<int>( schema.options.size()) - 1 ), percent( 0, 99 );
+  std::uniform_int_distribution<int> value( -100000, 100000 );
+
+  for( int ii = 0; ii < num_args; ii += 1 )
+    {
+      int roll = percent( rng );
+
+      if( roll < 20 )
+        {
+          args.push_back( "file_" + std::to_string( value( rng )));
+          continue;
+        }
+
+      const Schema::Option& one = schema.options[pick( rng )];
+
+      // the shortest prefix no other option starts with, or the full name
+
+      std::size_t unique = 1;
+
+      for( const auto& other : schema.options )
+        {
+          if( &other != &one )
+            {
+              std::size_t common = 0;
+
+              while( common < other.name.size() and common < one.name.size() and other.name[common] == one.name[common] )
+                {
+                  common += 1;
+                }
+
+              unique = std::max( unique, common + 1 );
+            }
+        }
+
+      std::string name = roll < 60 ? one.name : one.name.substr( 0, std::min( unique, one.name.size()));
+      args.push_back( "--" + name );
+
+      if( one.type == Schema::Type::integer )
+        {
+          args.push_back( std::to_string( value( rng )));
+        }
+      else if( one.type == Schema::Type::text )
+        {
+          args.push_back( "text_" + std::to_string( value( rng )));
+        }
+    }
+
+  if( percent( rng ) < 5 )
+    {
+      args.insert( args.begin() + 1, "--not_an_option" );
+    }
+
+  if( percent( rng ) < 5 )    // an option missing its value
+    {
+      for( const auto& one : schema.options )
+        {
+          if( one.type != Schema::Type::flag )
+            {
+              args.push_back( "--" + one.name );
+              break;
+            }
+        }
+    }
+
+  return args;
+}
+
+/* ----------------------------------------------------------------------------
+ * Parsing with each of them.  Building the schema, an OptionParser with its options or the longopts
+ * of getopt_long, is timed apart from parsing the command line.
+---------------------------------------------------------------------------- */
+struct OptionParserSchema
+{
+  parse_options::OptionParser parser;
+  bool flags[64] = {};
+  int integers[64] = {};
+  std::string texts[64];
+
+  explicit OptionParserSchema( const Schema& schema )
+  {
+    for( std::size_t ii = 0; ii < schema.options.size(); ii += 1 )
+      {
+        const auto& one = schema.options[ii];
+
+        switch( one.type )
+          {
+            case Schema::Type::flag: parser.add( one.name, "", &flags[ii] ); break;
+            case Schema::Type::integer: parser.add( one.name, "", &integers[ii] ); break;
+            case Schema::Type::text: parser.add( one.name, "", &texts[ii] ); break;
+          }
+      }
+  }
+};
+
+void parse_options_parse( OptionParserSchema& ours, const std::vector<const char*>& argv, Result& result )
+{
+  try
+    {
+      ours.parser.parse( static_cast<int>( argv.size()) - 1, argv.data());
+    }
+  catch( const std::invalid_argument& )
+    {
+      result.error = true;
+      return;
+    }
+
+  for( std::size_t ii = 0; ii < result.flags.size(); ii += 1 )
+    {
+      result.flags[ii] = ours.flags[ii];
+      result.integers[ii] = ours.integers[ii];
+      result.texts[ii] = ours.texts[ii];
+    }
+
+  for( const auto& one : ours.parser.pmr_non_option_args())
+    {
+      result.positionals.emplace_back( one );
+    }
+}
+
+void getopt_long_parse( const Schema& schema, const std::vector<option>& longopts, std::vector<char*>& argv,
+                        Result& result )
+{
+  int index = 0;
+
+  optind = 0;   // have glibc start over
+  opterr = 0;
+
+  for( int ch; (ch = getopt_long( static_cast<int>( argv.size()) - 1, argv.data(), "", longopts.data(), &index )) != -1; )
+    {
+      if( ch != 0 )
+        {
+          result.error = true;
+          return;
+        }
+
+      switch( schema.options[index].type )
+        {
+          case Schema::Type::flag: result.flags[index] = 1; break;
+          case Schema::Type::integer: result.integers[index] = std::atoi( optarg ); break;
+          case Schema::Type::text: result.texts[index] = optarg; break;
+        }
+    }
+
+  for( int ii = optind; ii < static_cast<int>( argv.size()) - 1; ii += 1 )
+    {
+      result.positionals.emplace_back( argv[ii] );
+    }
+}
+
+std::vector<option> getopt_options( const Schema& schema )
+{
+  std::vector<option> longopts;
+
+  for( const auto& one : schema.options )
+    {
+      longopts.push_back( { one.name.c_str(), one.type == Schema::Type::flag ? no_argument : required_argument,
+                            nullptr, 0 } );
+    }
+
+  longopts.push_back( { nullptr, 0, nullptr, 0 } );
+
+  return longopts;
+}
+
+/* ----------------------------------------------------------------------------
+ * main
+---------------------------------------------------------------------------- */
+int main( int argc, char* argv[] )
+{
+  struct
+  {
+    int seed{1};
+    int schemas{200};
+    int command_lines{50};
+    int num_options{24};
+    int num_args{30};
+  } options;
+
+  parse_options::OptionParser parser( "Compares OptionParser with getopt_long on randomized command lines" );
+  parser.add( "seed", "Seed of the random command lines", &options.seed );
+  parser.add( "schemas", "Random schemas to try", &options.schemas );
+  parser.add( "command_lines", "Random command lines per schema", &options.command_lines );
+  parser.add( "num_options", "Options in each schema, at most 64", &options.num_options );
+  parser.add( "num_args", "Options and arguments in each command line", &options.num_args );
+
+  try
+    {
+      parser.parse( argc, argv );
+
+      if( options.num_options < 1 or 64 < options.num_options )
+        {
+          throw std::invalid_argument( "ERROR: num_options must be between 1 and 64\n" );
+        }
+    }
+
+  catch( std::invalid_argument& e1 )
+    {
+      std::cerr << "# " << e1.what();
+      std::cerr << parser.usage();
+
+      return 1;
+    }
+
+  std::mt19937 rng( options.seed );
+
+  std::size_t num_compared = 0, num_errors = 0, num_different = 0;
+
+  // the time and the allocations of building the schema and of parsing, for each of the two
+
+  struct Cost
+  {
+    double ns{0};
+    std::size_t allocations{0};
+  } parse_options_schema, parse_options_parse_cost, getopt_schema, getopt_parse_cost;
+
+  auto measure = [&]( Cost& cost, auto&& work ) {
+    std::size_t allocations = num_allocations;
+    auto start = std::chrono::steady_clock::now();
+
+    work();
+
+    cost.ns += std::chrono::duration<double, std::nano>( std::chrono::steady_clock::now() - start ).count();
+    cost.allocations += num_allocations - allocations;
+  };
+
+  for( int ss = 0; ss < options.schemas; ss += 1 )
+    {
+      Schema schema = random_schema( rng, options.num_options );
+
+      for( int cc = 0; cc < options.command_lines; cc += 1 )
+        {
+          std::vector<std::string> args = random_command_line( rng, schema, options.num_args );
+
+          std::vector<const char*> const_argv;
+          std::vector<char*> mutable_argv;    // getopt_long permutes it
+
+          for( auto& one : args )
+            {
+              const_argv.push_back( one.c_str());
+              mutable_argv.push_back( &one[0] );
+            }
+
+          const_argv.push_back( nullptr );
+          mutable_argv.push_back( nullptr );
+
+          Result ours( schema ), theirs( schema );
+
+          // each command line gets a fresh parser, whose destinations start out clear
+
+          std::optional<OptionParserSchema> our_schema;
+          std::vector<option> longopts;
+
+          measure( parse_options_schema, [&]() { our_schema.emplace( schema ); } );
+          measure( parse_options_parse_cost, [&]() { parse_options_parse( *our_schema, const_argv, ours ); } );
+          measure( getopt_schema, [&]() { longopts = getopt_options( schema ); } );
+          measure( getopt_parse_cost, [&]() { getopt_long_parse( schema, longopts, mutable_argv, theirs ); } );
+
+          num_compared += 1;
+          num_errors += ours.error and theirs.error;
+
+          if( not (ours == theirs))
+            {
+              num_different += 1;
+
+              if( num_different <= 10 )
+                {
+                  std::cout << "different results (OptionParser " << (ours.error ? "failed" : "succeeded")
+                            << ", getopt_long " << (theirs.error ? "failed" : "succeeded") << "):";
+
+                  for( const auto& one : args )
+                    {
+                      std::cout << ' ' << one;
+                    }
+
+                  std::cout << "\n";
+                }
+            }
+        }
+    }
+
+  auto report = [&]( const char* name, const Cost& cost ) {
+    std::printf( "  %-22s %8.0f ns/command line  %6.1f allocations/command line\n", name, cost.ns / num_compared,
+                 double( cost.allocations ) / num_compared );
+  };
+
+  std::printf( "%zu command lines, %zu rejected by both, %zu different\n", num_compared, num_errors, num_different );
+  report( "OptionParser schema", parse_options_schema );
+  report( "OptionParser parse", parse_options_parse_cost );
+  report( "getopt_long longopts", getopt_schema );
+  report( "getopt_long parse", getopt_parse_cost );
+  std::printf( "  parsing alone, getopt_long is %.1fx the throughput of OptionParser\n",
+               parse_options_parse_cost.ns / getopt_parse_cost.ns );
+
+  return num_different != 0;
+}
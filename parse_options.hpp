@@ -25,15 +25,65 @@ SOFTWARE.
 #ifndef PARSE_OPTIONS_HPP
 #define PARSE_OPTIONS_HPP
 
+#include <cctype>
+#include <charconv>
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <chrono>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <typeinfo>
 #include <vector>
-#include <sstream>
+#include <istream>
+#include <ostream>
+#include <memory_resource>
 
-namespace parse_options
-{
+#include "parse_options_fwd.hpp"
+
+#if defined( __unix__ ) or defined( __APPLE__ )
+#define PARSE_OPTIONS_HAS_POSIX 1
+#define PARSE_OPTIONS_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined( __APPLE__ )
+#include <crt_externs.h>
+#endif
+
+PARSE_OPTIONS_NAMESPACE_BEGIN
 #define PARSE_OPTIONS_VERSION "1.0.0"
 
+  // Builds that never print help define PARSE_OPTIONS_NO_DESCRIPTIONS: descriptions are then neither
+  // stored nor copied, and usage() lists the option names only.  Wrap the descriptions given to add()
+  // in PARSE_OPTIONS_DESCRIPTION() to keep their text out of the binary as well.
+
+#if defined( PARSE_OPTIONS_NO_DESCRIPTIONS )
+#define PARSE_OPTIONS_DESCRIPTION( text ) ""
+  constexpr bool keep_descriptions = false;
+#else
+#define PARSE_OPTIONS_DESCRIPTION( text ) text
+  constexpr bool keep_descriptions = true;
+#endif
+
   class OptionRecord;   // Forward declare this class for the
 
   /// @class: OptionRecord
@@ -45,264 +95,3006 @@ namespace parse_options
     public:
       virtual ~OptionRecord() = default;
 
+      OptionRecord( const OptionRecord& ) = delete;
+      OptionRecord& operator=( const OptionRecord& ) = delete;
+
       virtual void parse( const char* value ) = 0;
 
       bool has_parameter() const { return has_parameter_; }
 
       bool matches( const std::string_view& arg_str ) const
       {
-        return (name_.compare( 0, arg_str.size(), arg_str.data()) == 0);
+        return (name_.compare( 0, arg_str.size(), arg_str ) == 0);
       }
 
-      const std::string& name() const { return name_; }
+      std::string_view name() const { return name_; }
 
-      const std::string& description() const { return description_; }
+      std::string_view description() const { return description_; }
 
-    protected:
+      /// @Method: record_size
+      /// @returns The size of the most derived record, so the parser can return it to its memory resource
+      virtual std::size_t record_size() const = 0;
 
-      OptionRecord( const std::string_view& name, const std::string_view& description, bool has_parameter ) :
-        name_( name ),
-        description_( description ),
-        has_parameter_( has_parameter ) {};
+      /// @Method: value_type
+      /// @returns The kind of value the option takes, for shell completion: "switch" when it takes none,
+      /// otherwise "int", "float", "string", "path", "file" or "value"
+      virtual std::string_view value_type() const { return has_parameter_ ? "value" : "switch"; }
 
-      std::string error_message( const std::string_view& err_str, const std::string_view& value )
+      /// @Method: format
+      /// Append the text of the current value of the option to out, in a form parse() reads back
+      /// @returns False, with nothing appended, when the type of the value has no text form: neither a
+      /// value_converter format nor operator<<
+      virtual bool format( std::pmr::string& out ) const = 0;
+
+      /// @Method: reads_back
+      /// @returns Whether parse() turns text, as format() wrote it, back into the same value.  An empty
+      /// value never does, since parse() rejects it.
+      virtual bool reads_back( const std::string_view& text ) const { return not text.empty(); }
+
+      /// @Method: hash
+      /// @returns The hash of the current value of the option, continuing from seed, or nothing when the
+      /// type of the value cannot be hashed, see is_hashable
+      virtual std::optional<std::uint64_t> hash( std::uint64_t seed ) const = 0;
+
+      /// @Method: save
+      /// @returns A copy of the current value of the option, or null when the option has no destination
+      /// or its records are not cacheable
+      virtual std::shared_ptr<const void> save() const = 0;
+
+      /// @Method: restore
+      /// Store a value returned by save() of an option of the same type into the destination
+      virtual void restore( const void* value ) = 0;
+
+      /// Whether save() and restore() can take a copy of the values of a record type, which the parse
+      /// caches need; a record type whose values cannot be copied hides this with false
+      static constexpr bool cacheable = true;
+
+      /// @Method: value_bytes
+      /// @returns The bytes the destination allocates on its own to hold value, such as a std::string does,
+      /// which the parser counts against its memory budget before parsing the value
+      virtual std::size_t value_bytes( const char* /* value */ ) const { return 0; }
+
+      /// @Method: error_message
+      /// Format the text of an error into a single buffer sized up front, without going through a stream
+      std::string error_message( const std::string_view& err_str, const std::string_view& value ) const
       {
-        std::ostringstream fmt;
-        fmt << "Error: " << err_str << "\n";
-        fmt << "  parameter: " << name_;
+        const std::string_view error_tag( "Error: " );
+        const std::string_view parameter_tag( "\n  parameter: " );
+        const std::string_view value_tag( "  value: \"" );
+        const std::string_view value_end( "\"\n" );
+
+        std::size_t len = error_tag.size() + err_str.size() + parameter_tag.size() + name_.size();
 
         if( not value.empty())
           {
-            fmt << "  value: \"" << value << "\"\n";
+            len += value_tag.size() + value.size() + value_end.size();
           }
 
-        return fmt.str();
+        std::string fmt;
+        fmt.reserve( len );
+
+        fmt.append( error_tag );
+        fmt.append( err_str );
+        fmt.append( parameter_tag );
+        fmt.append( name_ );
+
+        if( not value.empty())
+          {
+            fmt.append( value_tag );
+            fmt.append( value );
+            fmt.append( value_end );
+          }
+
+        return fmt;
+      }
+
+    protected:
+      friend class OptionParser;
+
+      OptionRecord( const std::string_view& name, const std::string_view& description, bool has_parameter,
+                    std::pmr::memory_resource* resource ) :
+        strings_( resource ),
+        has_parameter_( has_parameter )
+      {
+        const std::string_view kept = keep_descriptions ? description : std::string_view();
+
+        strings_.reserve( name.size() + kept.size());
+        strings_.append( name );
+        strings_.append( kept );
+
+        name_ = std::string_view( strings_.data(), name.size());
+        description_ = std::string_view( strings_.data() + name.size(), kept.size());
       }
 
-      std::string name_;
-      std::string description_;
+      std::pmr::string strings_;                // holds the name and the description, unless they are in a SchemaImage
+      std::string_view name_;
+      std::string_view description_;
       bool has_parameter_;
   };
 
 
-  /// @Class: ValueOption
-  /// @Description: This is a generic class for an option that requires an parameter to be provided
-  /// There is a specialized template for <bool> where the option is not required.
-  template<class T>
-  class ValueOption : public OptionRecord
+  /// @Class: ValueStreamBuf
+  /// @Description: A read-only stream buffer over the characters of an argument, so that values
+  /// can be extracted with operator>> without first copying them into a std::string.
+  class ValueStreamBuf : public std::streambuf
   {
     public:
-      ValueOption( const std::string_view& name, const std::string_view& description, T* dst_ptr ) :
-        OptionRecord( name, description, not std::is_same<bool, T>::value ), dst_ptr_( dst_ptr ) {};
-
-      void parse( const char* value ) override
+      explicit ValueStreamBuf( const std::string_view& value )
       {
-        if( value )
-          {
-            std::string value_str( value );
-            std::istringstream is( value_str );
-            int num_read = 0;
-
-            T parsed_value;
+        char* first = const_cast<char*>( value.data());
+        setg( first, first, first + value.size());
+      }
+  };
 
-            while( is.good())
-              {
-                if( is.peek() != EOF)
-                  is >> parsed_value;
-                else
-                  break;
 
-                num_read += 1;
-              }
+  /// @Class: FormatStreamBuf
+  /// @Description: A write-only stream buffer that appends to a string, used to format the values
+  /// of types that can only be written with operator<<.
+  class FormatStreamBuf : public std::streambuf
+  {
+    public:
+      explicit FormatStreamBuf( std::pmr::string& out ) : out_( out ) {}
 
-            if( not is.fail())
-              {
-                if( num_read == 1 )
-                  {
-                    if( dst_ptr_ )    // If this is null, the client wants us to silently ignore this parameter
-                      {
-                        *dst_ptr_ = parsed_value;
-                      }
-                  }
-                else if( 1 < num_read )
-                  {
-                    throw std::invalid_argument( error_message( "too many arguments", value ));
-                  }
-                else
-                  {
-                    throw std::invalid_argument( error_message( "empty value string", value ));
-                  }
-              }
-            else
-              {
-                throw std::invalid_argument( error_message( "parsing parameter failed", value ));
-              }
-          }
-        else
+    protected:
+      int_type overflow( int_type ch ) override
+      {
+        if( ch != traits_type::eof())
           {
-            throw std::invalid_argument( error_message( "missing argument", "" ));
+            out_.push_back( traits_type::to_char_type( ch ));
           }
+
+        return traits_type::not_eof( ch );
       }
 
-    protected:
-      T* dst_ptr_;    // Where to store the parsed value
+      std::streamsize xsputn( const char* str, std::streamsize count ) override
+      {
+        out_.append( str, count );
+        return count;
+      }
+
+    private:
+      std::pmr::string& out_;
   };
 
-  /// @Class: SwitchOption
-  /// @Description: This is a specialized version for boolean options that do not have parameters
-  class SwitchOption : public ValueOption<bool>
-  {
-    public:
-      SwitchOption( const std::string_view& opt_name, const std::string_view& description, bool* dst_ptr ) :
-        ValueOption<bool>( opt_name, description, dst_ptr ) {}
+  template<typename T, typename = void>
+  struct has_string_member : std::false_type {};
 
-      void parse( const char* /* param */ ) override
+  template<typename T>
+  struct has_string_member<T, std::void_t<decltype( std::declval<const T&>().string())>> : std::true_type {};
+
+  /// @Struct: value_converter
+  /// @Description: The customization point for the values of a user type, such as an address or a
+  /// byte size.  Specialize it with
+  ///
+  ///   static std::errc parse( std::string_view text, T& value );
+  ///
+  /// which, like from_chars, returns std::errc() on success, std::errc::result_out_of_range or any
+  /// other error, and options of type T are converted with it instead of operator>>.  The text is the
+  /// whole value, which parse has to consume.  A specialization may also have
+  ///
+  ///   static void format( const T& value, std::pmr::string& out );
+  ///
+  /// which appends the text of a value for arguments() and fingerprint(), instead of operator<<.  A
+  /// type with neither can still be parsed, but arguments() cannot write it.  The second parameter is for partial specializations with enable_if.
+  template<typename T, typename Enable>
+  struct value_converter {};
+
+  template<typename T, typename = void>
+  struct has_value_parser : std::false_type {};
+
+  template<typename T>
+  struct has_value_parser<T, std::void_t<decltype( value_converter<T>::parse( std::declval<std::string_view>(),
+                                                                              std::declval<T&>()))>>
+    : std::is_same<decltype( value_converter<T>::parse( std::declval<std::string_view>(), std::declval<T&>())),
+                   std::errc> {};
+
+  template<typename T, typename = void>
+  struct has_value_formatter : std::false_type {};
+
+  template<typename T>
+  struct has_value_formatter<T, std::void_t<decltype( value_converter<T>::format( std::declval<const T&>(),
+                                                                                  std::declval<std::pmr::string&>()))>>
+    : std::true_type {};
+
+  template<typename T, typename = void>
+  struct has_ostream_operator : std::false_type {};
+
+  template<typename T>
+  struct has_ostream_operator<T, std::void_t<decltype( std::declval<std::ostream&>() << std::declval<const T&>())>>
+    : std::true_type {};
+
+  /// @Struct: is_formattable
+  /// @Description: Whether format_value() can write the values of type T
+  template<typename T>
+  struct is_formattable
+    : std::bool_constant<has_value_formatter<T>::value or std::is_arithmetic_v<T>
+                         or std::is_convertible_v<const T&, std::string_view> or has_string_member<T>::value
+                         or has_ostream_operator<T>::value> {};
+
+  /// @Function: format_value
+  /// Append the text of a value to out.  Numbers go through to_chars, strings and paths are copied
+  /// as they are, types with a value_converter format go through it, and any other type is written
+  /// with operator<<.  Nothing is appended for a type that is not is_formattable.
+  template<typename T>
+  void format_value( const T& value, std::pmr::string& out )
+  {
+    if constexpr (has_value_formatter<T>::value)
       {
-        if( dst_ptr_ )
+        value_converter<T>::format( value, out );
+      }
+    else if constexpr (std::is_same_v<T, bool>)
+      {
+        out.append( value ? "true" : "false" );
+      }
+    else if constexpr (std::is_same_v<T, char>)
+      {
+        out.push_back( value );
+      }
+    else if constexpr (std::is_integral_v<T>
+#if defined( __cpp_lib_to_chars )
+                       or std::is_floating_point_v<T>
+#endif
+      )
+      {
+        char buffer[64];
+        auto result = std::to_chars( buffer, buffer + sizeof( buffer ), value );
+        out.append( buffer, result.ptr );
+      }
+    else if constexpr (std::is_convertible_v<const T&, std::string_view>)
+      {
+        out.append( std::string_view( value ));
+      }
+    else if constexpr (has_string_member<T>::value)   // std::filesystem::path, without the quotes of operator<<
+      {
+        out.append( value.string());
+      }
+    else if constexpr (has_ostream_operator<T>::value)
+      {
+        FormatStreamBuf out_buf( out );
+        std::ostream os( &out_buf );
+
+        if constexpr (std::is_floating_point_v<T>)
           {
-            *dst_ptr_ = true;
+            os.precision( std::numeric_limits<T>::max_digits10 );
           }
+
+        os << value;
       }
-  };
+  }
 
-  class OptionParser
+
+  /// @Function: xxhash64
+  /// The XXH64 hash of Yann Collet's xxHash (BSD 2-Clause License, Copyright (c) 2012-2021 Yann Collet),
+  /// reading the input in the byte order of the host.
+  inline std::uint64_t xxhash64( const void* data, std::size_t len, std::uint64_t seed = 0 )
   {
-    public:
-      explicit OptionParser( const std::string_view& description = "" ) : description_( description ) {}
+    constexpr std::uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+    constexpr std::uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+    constexpr std::uint64_t prime3 = 0x165667B19E3779F9ULL;
+    constexpr std::uint64_t prime4 = 0x85EBCA77C2B2AE63ULL;
+    constexpr std::uint64_t prime5 = 0x27D4EB2F165667C5ULL;
 
-      ~OptionParser()
+    auto rotl = []( std::uint64_t x, int r ) { return (x << r) | (x >> (64 - r)); };
+    auto read64 = []( const unsigned char* p ) { std::uint64_t v; std::memcpy( &v, p, sizeof( v )); return v; };
+    auto read32 = []( const unsigned char* p ) { std::uint32_t v; std::memcpy( &v, p, sizeof( v )); return v; };
+    auto round = [&]( std::uint64_t acc, std::uint64_t input ) { return rotl( acc + input * prime2, 31 ) * prime1; };
+    auto merge = [&]( std::uint64_t acc, std::uint64_t val ) { return (acc ^ round( 0, val )) * prime1 + prime4; };
+    auto avalanche = [&]( std::uint64_t h64 )
+    {
+      h64 ^= h64 >> 33;
+      h64 *= prime2;
+      h64 ^= h64 >> 29;
+      h64 *= prime3;
+      h64 ^= h64 >> 32;
+      return h64;
+    };
+
+    if( len == 0 )   // data may be null, which no pointer arithmetic is defined on
       {
-        for( auto* one : option_ )
+        return avalanche( seed + prime5 );
+      }
+
+    const unsigned char* p = static_cast<const unsigned char*>( data );
+    const unsigned char* end = p + len;
+    std::uint64_t h64;
+
+    if( 32 <= len )
+      {
+        std::uint64_t v1 = seed + prime1 + prime2;
+        std::uint64_t v2 = seed + prime2;
+        std::uint64_t v3 = seed;
+        std::uint64_t v4 = seed - prime1;
+
+        for( ; 32 <= end - p; p += 32 )
           {
-            delete one;
+            v1 = round( v1, read64( p ));
+            v2 = round( v2, read64( p + 8 ));
+            v3 = round( v3, read64( p + 16 ));
+            v4 = round( v4, read64( p + 24 ));
           }
 
-        option_.clear();
+        h64 = rotl( v1, 1 ) + rotl( v2, 7 ) + rotl( v3, 12 ) + rotl( v4, 18 );
+        h64 = merge( h64, v1 );
+        h64 = merge( h64, v2 );
+        h64 = merge( h64, v3 );
+        h64 = merge( h64, v4 );
+      }
+    else
+      {
+        h64 = seed + prime5;
       }
 
-      /// @Method: Add an option specifying the type and name
-      /// @param T is the type for the option, either std::string, or int
-      /// @param opt_name The name of the option, minus any dashes
-      template<typename T>
-      void add( const std::string_view& opt_name,
-                const std::string_view& description,
-                T* dst_ptr )
+    h64 += len;
+
+    for( ; 8 <= end - p; p += 8 )
       {
-        option_.push_back( new ValueOption<T>( opt_name, description, dst_ptr ));
+        h64 ^= round( 0, read64( p ));
+        h64 = rotl( h64, 27 ) * prime1 + prime4;
       }
 
-      /// @Method: Add a boolean option
-      /// This is specialized version of the general add method for just booleans
-      template<>
-      void add<bool>( const std::string_view& opt_name,
-                      const std::string_view& description,
-                      bool* dst_ptr )
+    if( 4 <= end - p )
       {
-        option_.push_back( new SwitchOption( opt_name, description, dst_ptr ));
+        h64 ^= read32( p ) * prime1;
+        h64 = rotl( h64, 23 ) * prime2 + prime3;
+        p += 4;
       }
 
-      /// @Method: parse
-      /// @param argc The number of arguments as passed to main
-      /// @param argv The list of pointers to the initializers
-      void parse( int argc, const char* const argv[] )
+    for( ; p < end; p += 1 )
       {
-        for( int ii = 1; ii < argc; ii += 1 )
-          {
-            const char* pp = argv[ii];
-            size_t plen = std::strlen( pp );
+        h64 ^= *p * prime5;
+        h64 = rotl( h64, 11 ) * prime1;
+      }
 
-            if( 0 < plen )
-              {
-                int pi = 0;   // parameter index
+    return avalanche( h64 );
+  }
 
-                if( pp[0] == '-' )    // this is an option
-                  {
-                    pi = 1;
-                    if( 1 < plen and pp[1] == '-' ) // check for '--'
-                      {
-                        pi = 2;
-                      }
+  template<typename T, typename = void>
+  struct has_native_member : std::false_type {};
 
-                    std::string param( &pp[pi], plen - pi );    // extract the parameter name
+  template<typename T>
+  struct has_native_member<T, std::void_t<decltype( std::declval<const T&>().native().data())>> : std::true_type {};
 
-                    // loop over all of the options and see if this one that we recognize
+  /// @Function: value_type_name
+  /// @returns The value_type() of options that hold a T
+  template<typename T>
+  constexpr std::string_view value_type_name()
+  {
+    if constexpr (std::is_same_v<T, bool>)
+      {
+        return "switch";
+      }
+    else if constexpr (std::is_integral_v<T>)
+      {
+        return "int";
+      }
+    else if constexpr (std::is_floating_point_v<T>)
+      {
+        return "float";
+      }
+    else if constexpr (has_native_member<T>::value)
+      {
+        return "path";
+      }
+    else if constexpr (std::is_convertible_v<const T&, std::string_view>)
+      {
+        return "string";
+      }
+    else
+      {
+        return "value";
+      }
+  }
 
-                    bool found = false;
+  /// @Struct: is_hashable
+  /// @Description: Whether hash_value() can hash the values of type T, which takes a text form for the
+  /// types that are not numbers, strings or paths
+  template<typename T>
+  struct is_hashable : std::bool_constant<is_formattable<T>::value or has_native_member<T>::value> {};
 
-                    for( auto* one : option_ )
-                      {
-                        if( one->matches( param ))
-                          {
-                            found = true;
+  /// @Function: hash_value
+  /// @returns The hash of a value continuing from seed.  Integers, floats and doubles hash their bytes,
+  /// with the zeros and the NaNs made one value each, strings and paths their characters, and other types the text format_value() gives them, which
+  /// only allocates when that text is long.
+  template<typename T>
+  std::uint64_t hash_value( const T& value, std::uint64_t seed )
+  {
+    if constexpr (std::is_integral_v<T>)
+      {
+        return xxhash64( &value, sizeof( T ), seed );
+      }
+    else if constexpr (std::is_floating_point_v<T> and sizeof( T ) <= 8)
+      {
+        // values that compare equal hash equal: -0.0 as 0.0, and every NaN as the same one
+        T canonical = value == 0 ? T( 0 ) : value;
 
-                            if( one->has_parameter() and ii + 1 < argc )   // extract the parameter
-                              {
-                                ii += 1;
-                                one->parse( argv[ii] );
-                                break;
-                              }
-                            else
-                              {
-                                one->parse( nullptr );
-                              }
-                          }
-                      }
+        if( std::isnan( value ))
+          {
+            canonical = std::numeric_limits<T>::quiet_NaN();
+          }
 
-                    if( not found )
-                      {
-                        std::string err_str( "ERROR: unrecognized option: " );
-                        err_str.append( pp );
-                        err_str.append( "\n" );
+        return xxhash64( &canonical, sizeof( T ), seed );
+      }
+    else if constexpr (std::is_convertible_v<const T&, std::string_view>)
+      {
+        std::string_view text( value );
+        return xxhash64( text.data(), text.size(), seed );
+      }
+    else if constexpr (has_native_member<T>::value)
+      {
+        const auto& text = value.native();
+        return xxhash64( text.data(), text.size() * sizeof( text[0] ), seed );
+      }
+    else
+      {
+        static_assert( is_formattable<T>::value, "the type has no text form to hash" );
 
-                        throw std::invalid_argument( err_str );
-                      }
-                  }
-                else
-                  {
-                    non_option_args_.emplace_back( pp, plen );
-                  }
-              } // else, the string is empty -- ignore it
-          } // end for loop over the arguments
+        char buffer[256];
+        std::pmr::monotonic_buffer_resource pool( buffer, sizeof( buffer ));
+        std::pmr::string text( &pool );
+        text.reserve( sizeof( buffer ) - 32 );
+
+        format_value( value, text );
+
+        return xxhash64( text.data(), text.size(), seed );
       }
+  }
 
-      /// @Method: non_option_args
-      /// @returns A vector contained all of the parameters not used as options
-      const std::vector<std::string>& non_option_args() const { return non_option_args_; }
+  /// @Enum: ValueKind
+  /// @Description: The kinds of value the shared converters handle.  With PARSE_OPTIONS_SHARED_CONVERTERS,
+  /// ValueOption<T> for a T of one of these kinds converts through a table of non-template functions,
+  /// one per kind, instead of instantiating operator>> for every T.
+  enum class ValueKind : unsigned char
+  {
+    signed_integer,
+    unsigned_integer,
+    single_float,
+    double_float,
+    string,
+    other     // converted with operator>>
+  };
 
-      const std::string usage() const
+  /// @Function: value_kind
+  /// @returns The kind of the values of type T
+  template<typename T>
+  constexpr ValueKind value_kind()
+  {
+    if constexpr (std::is_same_v<T, short> or std::is_same_v<T, int> or std::is_same_v<T, long>
+                  or std::is_same_v<T, long long>)
       {
-        std::string u_str = description_ + "\n\nOPTIONS:\n\n";
-
-        const int break_col = 20;
+        return ValueKind::signed_integer;
+      }
+    else if constexpr (std::is_same_v<T, unsigned short> or std::is_same_v<T, unsigned> or
+                       std::is_same_v<T, unsigned long> or std::is_same_v<T, unsigned long long>)
+      {
+        return ValueKind::unsigned_integer;
+      }
+    else if constexpr (std::is_same_v<T, float>)
+      {
+        return ValueKind::single_float;
+      }
+    else if constexpr (std::is_same_v<T, double>)
+      {
+        return ValueKind::double_float;
+      }
+    else if constexpr (std::is_same_v<T, std::string>)
+      {
+        return ValueKind::string;
+      }
+    else
+      {
+        return ValueKind::other;
+      }
+  }
 
-        for( const auto& one : option_ )
-          {
-            u_str.append( "  --" );
-            u_str.append( one->name());
+  /// @Struct: ConvertedValue
+  /// @Description: Where a shared converter leaves the value it read, in the widest type of its kind,
+  /// and the range an integer has to fit in
+  struct ConvertedValue
+  {
+    long long signed_value{0};
+    unsigned long long unsigned_value{0};
+    float float_value{0};
+    double double_value{0};
+    std::string string_value;
+    long long min{0};
+    unsigned long long max{0};
+  };
 
-            int num_align = break_col - (one->name().length() + 4);
-            if( 0 < num_align )
-              {
-                u_str.append( num_align, ' ' );
-              }
-            else
-              {
-                u_str.append( "\n" );
-                u_str.append( break_col, ' ' );
-              }
-            u_str.append( one->description());
-            u_str.append( "\n" );
-          }
+  /// @Function: convert_signed, convert_unsigned, convert_float, convert_double, convert_string
+  /// Read one value of a kind at pos, which is not whitespace, as operator>> would, and move pos past it
+  /// @returns False when there is no value of that kind at pos
+  inline bool convert_signed( const char*& pos, const char* end, ConvertedValue& out )
+  {
+    const char* first = *pos == '+' and pos + 1 != end and pos[1] != '-' ? pos + 1 : pos;   // from_chars takes no '+'
+    long long value = 0;
+    auto result = std::from_chars( first, end, value );
 
-        return u_str;
+    if( result.ec != std::errc() or value < out.min or (0 < value and out.max < static_cast<unsigned long long>( value )))
+      {
+        return false;
       }
 
-    protected:
+    out.signed_value = value;
+    pos = result.ptr;
+    return true;
+  }
 
-      std::string description_;
-      std::vector<OptionRecord*> option_;
-      std::vector<std::string> non_option_args_;
-  };
-}
+  inline bool convert_unsigned( const char*& pos, const char* end, ConvertedValue& out )
+  {
+    const char* first = *pos == '+' ? pos + 1 : pos;
+    unsigned long long value = 0;
+    auto result = std::from_chars( first, end, value );
+
+    if( result.ec != std::errc() or out.max < value )
+      {
+        return false;
+      }
+
+    out.unsigned_value = value;
+    pos = result.ptr;
+    return true;
+  }
+
+  template<typename F>
+  bool convert_floating( const char*& pos, const char* end, F& value )
+  {
+    const char* first = *pos == '+' and pos + 1 != end and pos[1] != '-' ? pos + 1 : pos;
+#if defined( __cpp_lib_to_chars )
+    auto result = std::from_chars( first, end, value );
+
+    if( result.ec != std::errc())
+      {
+        return false;
+      }
+
+    pos = result.ptr;
+#else
+    char* last = nullptr;
+    errno = 0;
+    value = std::is_same_v<F, float> ? std::strtof( first, &last ) : std::strtod( first, &last );
+
+    if( last == first or errno == ERANGE )
+      {
+        return false;
+      }
+
+    pos = last;
+#endif
+    (void) end;
+    return true;
+  }
+
+  inline bool convert_float( const char*& pos, const char* end, ConvertedValue& out )
+  {
+    return convert_floating( pos, end, out.float_value );
+  }
+
+  inline bool convert_double( const char*& pos, const char* end, ConvertedValue& out )
+  {
+    return convert_floating( pos, end, out.double_value );
+  }
+
+  inline bool convert_string( const char*& pos, const char* end, ConvertedValue& out )
+  {
+    const char* last = pos;
+
+    while( last != end and not std::isspace( static_cast<unsigned char>( *last )))
+      {
+        last += 1;
+      }
+
+    out.string_value.assign( pos, last );
+    pos = last;
+    return true;
+  }
+
+  /// @Var: converters
+  /// The shared converters, indexed by ValueKind
+  inline constexpr bool (*converters[])( const char*&, const char*, ConvertedValue& ) = {
+    convert_signed, convert_unsigned, convert_float, convert_double, convert_string
+  };
+
+  /// @Function: convert_value
+  /// Read the values in an argument with the converter of a kind, the way ValueOption reads them with
+  /// operator>>: values may be separated and preceded by whitespace, but not followed by it
+  /// @returns The number of values read, or -1 when the argument holds something else
+  inline int convert_value( const char* value, ValueKind kind, ConvertedValue& out )
+  {
+    const char* pos = value;
+    const char* end = value + std::strlen( value );
+    int num_read = 0;
+
+    while( pos != end )
+      {
+        while( pos != end and std::isspace( static_cast<unsigned char>( *pos )))
+          {
+            pos += 1;
+          }
+
+        if( pos == end or not converters[static_cast<int>( kind )]( pos, end, out ))
+          {
+            return -1;
+          }
+
+        num_read += 1;
+      }
+
+    return num_read;
+  }
+
+  /// @Class: ValueOption
+  /// @Description: This is a generic class for an option that requires an parameter to be provided
+  /// There is a specialized template for <bool> where the option is not required.
+  template<class T>
+  class ValueOption : public OptionRecord
+  {
+    public:
+      ValueOption( const std::string_view& name, const std::string_view& description, T* dst_ptr,
+                   std::pmr::memory_resource* resource = std::pmr::get_default_resource()) :
+        OptionRecord( name, description, not std::is_same<bool, T>::value, resource ), dst_ptr_( dst_ptr ) {};
+
+      std::size_t record_size() const override { return sizeof( *this ); }
+
+      std::string_view value_type() const override
+      {
+        return has_parameter() ? value_type_name<T>() : "switch";
+      }
+
+      bool format( std::pmr::string& out ) const override
+      {
+        if( dst_ptr_ )
+          {
+            format_value( *dst_ptr_, out );
+          }
+
+        return is_formattable<T>::value;
+      }
+
+      /// @Method: reads_back
+      /// operator>> and the shared converters stop at whitespace, so only a value_converter parse reads
+      /// back a value that holds some
+      bool reads_back( const std::string_view& text ) const override
+      {
+        if constexpr (has_value_parser<T>::value)
+          {
+            return not text.empty();
+          }
+        else
+          {
+            return not text.empty() and std::none_of( text.begin(), text.end(), []( char ch ) {
+              return std::isspace( static_cast<unsigned char>( ch ));
+            } );
+          }
+      }
+
+      std::optional<std::uint64_t> hash( std::uint64_t seed ) const override
+      {
+        if constexpr (is_hashable<T>::value)
+          {
+            return dst_ptr_ ? hash_value( *dst_ptr_, seed ) : seed;
+          }
+        else
+          {
+            return std::nullopt;
+          }
+      }
+
+      static constexpr bool cacheable = std::is_copy_constructible_v<T> and std::is_copy_assignable_v<T>;
+
+      std::shared_ptr<const void> save() const override
+      {
+        if constexpr (cacheable)
+          {
+            return dst_ptr_ ? std::make_shared<const T>( *dst_ptr_ ) : nullptr;
+          }
+        else
+          {
+            return nullptr;
+          }
+      }
+
+      void restore( const void* value ) override
+      {
+        if constexpr (cacheable)
+          {
+            if( dst_ptr_ and value )
+              {
+                *dst_ptr_ = *static_cast<const T*>( value );
+              }
+          }
+      }
+
+      std::size_t value_bytes( const char* value ) const override
+      {
+        if constexpr (std::is_convertible_v<const T&, std::string_view> or has_native_member<T>::value)
+          {
+            return dst_ptr_ and value ? std::strlen( value ) + 1 : 0;
+          }
+        else
+          {
+            return 0;
+          }
+      }
+
+      void parse( const char* value ) override
+      {
+        if constexpr (has_value_parser<T>::value)
+          {
+            parse_converter( value );
+          }
+#if defined( PARSE_OPTIONS_SHARED_CONVERTERS )
+        else if constexpr (value_kind<T>() != ValueKind::other)
+          {
+            parse_shared( value );
+          }
+#endif
+        else
+          {
+            parse_istream( value );
+          }
+      }
+
+    protected:
+      /// @Method: parse_converter
+      /// Convert the whole value with the value_converter the user gave for T.  A template, so the
+      /// explicit instantiations of types without a converter leave it out.
+      template<typename U = T>
+      void parse_converter( const char* value )
+      {
+        if( not value )
+          {
+            throw std::invalid_argument( error_message( "missing argument", "" ));
+          }
+        else if( *value == '\0' )
+          {
+            throw std::invalid_argument( error_message( "empty value string", value ));
+          }
+
+        U parsed_value{};
+        std::errc result = value_converter<U>::parse( std::string_view( value ), parsed_value );
+
+        if( result == std::errc::result_out_of_range )
+          {
+            throw std::invalid_argument( error_message( "value out of range", value ));
+          }
+        else if( result != std::errc())
+          {
+            throw std::invalid_argument( error_message( "parsing parameter failed", value ));
+          }
+
+        if( dst_ptr_ )    // If this is null, the client wants us to silently ignore this parameter
+          {
+            *dst_ptr_ = std::move( parsed_value );
+          }
+      }
+
+      /// @Method: parse_istream
+      /// Convert with operator>>, for the types without a faster converter.  A template, so that the
+      /// explicit instantiations of types with a value_converter need no operator>>.
+      template<typename U = T>
+      void parse_istream( const char* value )
+      {
+        if( value )
+          {
+            ValueStreamBuf value_buf( value );
+            std::istream is( &value_buf );
+            int num_read = 0;
+
+            U parsed_value;
+
+            while( is.good())
+              {
+                if( is.peek() != EOF)
+                  is >> parsed_value;
+                else
+                  break;
+
+                num_read += 1;
+              }
+
+            if( not is.fail())
+              {
+                if( num_read == 1 )
+                  {
+                    if( dst_ptr_ )    // If this is null, the client wants us to silently ignore this parameter
+                      {
+                        *dst_ptr_ = std::move( parsed_value );
+                      }
+                  }
+                else if( 1 < num_read )
+                  {
+                    throw std::invalid_argument( error_message( "too many arguments", value ));
+                  }
+                else
+                  {
+                    throw std::invalid_argument( error_message( "empty value string", value ));
+                  }
+              }
+            else
+              {
+                throw std::invalid_argument( error_message( "parsing parameter failed", value ));
+              }
+          }
+        else
+          {
+            throw std::invalid_argument( error_message( "missing argument", "" ));
+          }
+      }
+
+#if defined( PARSE_OPTIONS_SHARED_CONVERTERS )
+      /// @Method: parse_shared
+      /// The typed end of the shared converters: set the range, convert, and store the result.  Only
+      /// the types the table covers get here; a template, so that no other type instantiates it.
+      template<typename U = T>
+      void parse_shared( const char* value )
+      {
+        constexpr ValueKind kind = value_kind<U>();
+        static_assert( kind != ValueKind::other, "the shared converters do not cover this type" );
+
+        if( not value )
+          {
+            throw std::invalid_argument( error_message( "missing argument", "" ));
+          }
+
+        ConvertedValue converted;
+
+        if constexpr (kind == ValueKind::signed_integer or kind == ValueKind::unsigned_integer)
+          {
+            converted.min = std::numeric_limits<U>::min();
+            converted.max = std::numeric_limits<U>::max();
+          }
+
+        int num_read = convert_value( value, kind, converted );
+
+        if( num_read < 0 )
+          {
+            throw std::invalid_argument( error_message( "parsing parameter failed", value ));
+          }
+        else if( 1 < num_read )
+          {
+            throw std::invalid_argument( error_message( "too many arguments", value ));
+          }
+        else if( num_read == 0 )
+          {
+            throw std::invalid_argument( error_message( "empty value string", value ));
+          }
+
+        if( dst_ptr_ )
+          {
+            if constexpr (kind == ValueKind::signed_integer)
+              {
+                *dst_ptr_ = static_cast<U>( converted.signed_value );
+              }
+            else if constexpr (kind == ValueKind::unsigned_integer)
+              {
+                *dst_ptr_ = static_cast<U>( converted.unsigned_value );
+              }
+            else if constexpr (kind == ValueKind::single_float)
+              {
+                *dst_ptr_ = converted.float_value;
+              }
+            else if constexpr (kind == ValueKind::double_float)
+              {
+                *dst_ptr_ = converted.double_value;
+              }
+            else if constexpr (kind == ValueKind::string)
+              {
+                *dst_ptr_ = std::move( converted.string_value );
+              }
+          }
+      }
+#endif
+
+      T* dst_ptr_;    // Where to store the parsed value
+  };
+
+  /// @Class: DeferredDefault
+  /// @Description: The part of an option with a computed default that the parser sees: whether the
+  /// last parse set the option, and the hook that supplies the default when it did not.
+  class DeferredDefault
+  {
+    public:
+      virtual void apply_default() = 0;
+
+    protected:
+      ~DeferredDefault() = default;
+
+      bool given_{false};
+
+      friend class OptionParser;
+  };
+
+  /// @Class: DeferredOption
+  /// @Description: An option whose default is computed by a callable, which runs only after a parse
+  /// that did not set the option, and at most once: its result is kept for the parses that follow.
+  template<class T>
+  class DeferredOption : public ValueOption<T>, public DeferredDefault
+  {
+    public:
+      using ValueOption<T>::ValueOption;
+
+      std::size_t record_size() const override { return sizeof( *this ); }
+
+      void parse( const char* value ) override
+      {
+        if constexpr (std::is_same_v<T, bool>)   // a switch, as SwitchOption, which takes no value
+          {
+            if( this->dst_ptr_ )
+              {
+                *this->dst_ptr_ = true;
+              }
+          }
+        else
+          {
+            ValueOption<T>::parse( value );
+          }
+
+        given_ = true;
+      }
+
+      void restore( const void* value ) override
+      {
+        ValueOption<T>::restore( value );
+        given_ = true;
+      }
+
+      void apply_default() override
+      {
+        if( not computed_ )
+          {
+            computed_ = compute_();
+          }
+
+        if( this->dst_ptr_ )
+          {
+            *this->dst_ptr_ = *computed_;
+          }
+      }
+
+    protected:
+      std::function<T()> compute_;
+      std::optional<T> computed_;
+
+      friend class OptionParser;
+  };
+
+  /// @Class: SwitchOption
+  /// @Description: This is a specialized version for boolean options that do not have parameters
+  class SwitchOption : public ValueOption<bool>
+  {
+    public:
+      SwitchOption( const std::string_view& opt_name, const std::string_view& description, bool* dst_ptr,
+                    std::pmr::memory_resource* resource = std::pmr::get_default_resource()) :
+        ValueOption<bool>( opt_name, description, dst_ptr, resource ) {}
+
+      std::size_t record_size() const override { return sizeof( *this ); }
+
+      void parse( const char* /* param */ ) override
+      {
+        if( dst_ptr_ )
+          {
+            *dst_ptr_ = true;
+          }
+      }
+  };
+
+#if defined( PARSE_OPTIONS_HAS_MMAP )
+  /// @Class: ArgumentFile
+  /// @Description: A file of NUL separated arguments, as written by find -print0, mapped read-only into
+  /// memory.  Iterating over it yields views of the arguments in the mapping itself, so no string is
+  /// allocated per argument and the memory used is that of the mapping.  Empty arguments are skipped.
+  class ArgumentFile
+  {
+    public:
+      class iterator
+      {
+        public:
+          using iterator_category = std::forward_iterator_tag;
+          using value_type = std::string_view;
+          using difference_type = std::ptrdiff_t;
+          using pointer = const std::string_view*;
+          using reference = const std::string_view&;
+
+          iterator( const char* pos, const char* end ) : end_( end ) { advance( pos ); }
+
+          reference operator*() const { return current_; }
+
+          pointer operator->() const { return &current_; }
+
+          iterator& operator++()
+          {
+            advance( current_.data() + current_.size());
+            return *this;
+          }
+
+          iterator operator++( int )
+          {
+            iterator previous = *this;
+            ++*this;
+            return previous;
+          }
+
+          bool operator==( const iterator& other ) const { return current_.data() == other.current_.data(); }
+
+          bool operator!=( const iterator& other ) const { return not (*this == other); }
+
+        private:
+          void advance( const char* pos )
+          {
+            while( pos < end_ and *pos == '\0' )   // skip separators and empty arguments
+              {
+                pos += 1;
+              }
+
+            const char* next = pos < end_ ? static_cast<const char*>( std::memchr( pos, '\0', end_ - pos )) : end_;
+            current_ = std::string_view( pos, (next ? next : end_) - pos );
+          }
+
+          const char* end_;
+          std::string_view current_;
+      };
+
+      ArgumentFile() = default;
+
+      explicit ArgumentFile( const std::string_view& path ) { open( path ); }
+
+      ArgumentFile( ArgumentFile&& other ) noexcept { swap( other ); }
+
+      ArgumentFile& operator=( ArgumentFile&& other ) noexcept
+      {
+        ArgumentFile moved( std::move( other ));
+        swap( moved );
+        return *this;
+      }
+
+      ~ArgumentFile() { close(); }
+
+      /// @Method: open
+      /// Map the file, replacing the one mapped before
+      /// @throws std::invalid_argument when the file cannot be opened or mapped
+      void open( const std::string_view& path )
+      {
+        std::string path_str( path );
+        int fd = ::open( path_str.c_str(), O_RDONLY );
+
+        if( fd < 0 )
+          {
+            throw std::invalid_argument( "ERROR: cannot open argument file: " + path_str + "\n" );
+          }
+
+        struct stat st;
+        void* data = nullptr;
+
+        if( fstat( fd, &st ) == 0 and 0 < st.st_size )
+          {
+            data = mmap( nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+          }
+
+        ::close( fd );
+
+        if( data == MAP_FAILED )
+          {
+            throw std::invalid_argument( "ERROR: cannot map argument file: " + path_str + "\n" );
+          }
+
+#if defined( POSIX_MADV_SEQUENTIAL )
+        if( data )
+          {
+            posix_madvise( data, st.st_size, POSIX_MADV_SEQUENTIAL );
+          }
+#endif
+
+        close();
+
+        data_ = static_cast<const char*>( data );
+        size_ = data ? st.st_size : 0;
+        path_ = std::move( path_str );
+      }
+
+      void close()
+      {
+        if( data_ )
+          {
+            munmap( const_cast<char*>( data_ ), size_ );
+          }
+
+        data_ = nullptr;
+        size_ = 0;
+        path_.clear();
+      }
+
+      const std::string& path() const { return path_; }
+
+      /// @returns The size of the mapping in bytes
+      std::size_t size_bytes() const { return size_; }
+
+      /// @returns The number of arguments, which takes a pass over the file
+      std::size_t count() const { return std::distance( begin(), end()); }
+
+      iterator begin() const { return iterator( data_, data_ + size_ ); }
+
+      iterator end() const { return iterator( data_ + size_, data_ + size_ ); }
+
+    private:
+      void swap( ArgumentFile& other ) noexcept
+      {
+        std::swap( data_, other.data_ );
+        std::swap( size_, other.size_ );
+        std::swap( path_, other.path_ );
+      }
+
+      const char* data_{nullptr};
+      std::size_t size_{0};
+      std::string path_;
+  };
+
+  /// @Class: ArgumentFileOption
+  /// @Description: An option whose value is the path of an ArgumentFile, which is mapped when it is parsed
+  class ArgumentFileOption : public OptionRecord
+  {
+    public:
+      ArgumentFileOption( const std::string_view& name, const std::string_view& description, ArgumentFile* dst_ptr,
+                          std::pmr::memory_resource* resource = std::pmr::get_default_resource()) :
+        OptionRecord( name, description, true, resource ), dst_ptr_( dst_ptr ) {};
+
+      std::size_t record_size() const override { return sizeof( *this ); }
+
+      std::string_view value_type() const override { return "file"; }
+
+      void parse( const char* value ) override
+      {
+        if( not value )
+          {
+            throw std::invalid_argument( error_message( "missing argument", "" ));
+          }
+
+        if( dst_ptr_ )
+          {
+            try
+              {
+                dst_ptr_->open( value );
+              }
+            catch( const std::invalid_argument& )
+              {
+                throw std::invalid_argument( error_message( "cannot map argument file", value ));
+              }
+          }
+      }
+
+      bool format( std::pmr::string& out ) const override
+      {
+        if( dst_ptr_ )
+          {
+            out.append( dst_ptr_->path());
+          }
+
+        return true;
+      }
+
+      std::optional<std::uint64_t> hash( std::uint64_t seed ) const override
+      {
+        return dst_ptr_ ? hash_value( dst_ptr_->path(), seed ) : seed;
+      }
+
+      std::shared_ptr<const void> save() const override
+      {
+        return dst_ptr_ ? std::make_shared<const std::string>( dst_ptr_->path()) : nullptr;
+      }
+
+      void restore( const void* value ) override
+      {
+        if( dst_ptr_ and value )
+          {
+            parse( static_cast<const std::string*>( value )->c_str());
+          }
+      }
+
+    protected:
+      ArgumentFile* dst_ptr_;
+  };
+#endif
+
+  /// @Class: ParseLimitError
+  /// @Description: Thrown by OptionParser::parse when one of its ParseLimits is exceeded.  It derives
+  /// from std::invalid_argument so existing error handling still catches it, and it reports which
+  /// limit was hit, the budget and how much had been used.
+  class ParseLimitError : public std::invalid_argument
+  {
+    public:
+      enum class Limit { memory, tokens, time };
+
+      ParseLimitError( Limit limit, std::size_t budget, std::size_t used ) :
+        std::invalid_argument( message( limit, budget, used )),
+        limit_( limit ),
+        budget_( budget ),
+        used_( used ) {}
+
+      Limit limit() const { return limit_; }
+
+      /// @returns The budget in bytes, tokens or microseconds depending on limit()
+      std::size_t budget() const { return budget_; }
+
+      /// @returns The amount used when parsing stopped, in the same units as budget()
+      std::size_t used() const { return used_; }
+
+    private:
+      static std::string message( Limit limit, std::size_t budget, std::size_t used )
+      {
+        const char* what = "memory";
+        const char* units = "bytes";
+
+        if( limit == Limit::tokens )
+          {
+            what = "token";
+            units = "tokens";
+          }
+        else if( limit == Limit::time )
+          {
+            what = "time";
+            units = "microseconds";
+          }
+
+        std::string err_str( "ERROR: parse " );
+        err_str.append( what );
+        err_str.append( " budget exceeded: " );
+        err_str.append( std::to_string( used ));
+        err_str.append( " of " );
+        err_str.append( std::to_string( budget ));
+        err_str.append( " " );
+        err_str.append( units );
+        err_str.append( "\n" );
+
+        return err_str;
+      }
+
+      Limit limit_;
+      std::size_t budget_;
+      std::size_t used_;
+  };
+
+  /// @Struct: ParseLimits
+  /// @Description: Budgets applied to each call of OptionParser::parse.  A value of zero means unlimited.
+  struct ParseLimits
+  {
+    std::size_t max_bytes{0};                 // bytes the parser may allocate while parsing
+    std::size_t max_tokens{0};                // arguments after the program name
+    std::chrono::microseconds max_time{0};    // wall clock time spent parsing
+  };
+
+  /// @Class: AccountingResource
+  /// @Description: A memory resource that forwards to an upstream resource while keeping track of
+  /// the bytes in use and allocated.  When a budget is armed, an allocation that would take the bytes
+  /// allocated since the budget was armed past the limit throws ParseLimitError instead.
+  class AccountingResource : public std::pmr::memory_resource
+  {
+    public:
+      explicit AccountingResource( std::pmr::memory_resource* upstream ) : upstream_( upstream ) {}
+
+      std::pmr::memory_resource* upstream() const { return upstream_; }
+
+      /// @returns The number of bytes currently allocated and not yet returned
+      std::size_t bytes_in_use() const { return in_use_; }
+
+      /// @returns The total number of bytes ever allocated through this resource
+      std::size_t bytes_allocated() const { return allocated_; }
+
+      void arm_budget( std::size_t max_bytes )
+      {
+        budget_ = max_bytes;
+        mark_ = allocated_;
+        charged_ = 0;
+      }
+
+      void disarm_budget() { budget_ = 0; }
+
+      /// @Method: charge
+      /// Count bytes allocated elsewhere on behalf of the parse, such as by std::string destinations, against
+      /// the budget.  They are not part of bytes_allocated().
+      /// @throws ParseLimitError when they take the parse past its budget
+      void charge( std::size_t bytes )
+      {
+        if( budget_ and budget_ < allocated_ - mark_ + charged_ + bytes )
+          {
+            throw ParseLimitError( ParseLimitError::Limit::memory, budget_, allocated_ - mark_ + charged_ + bytes );
+          }
+
+        charged_ += bytes;
+      }
+
+    protected:
+      void* do_allocate( std::size_t bytes, std::size_t alignment ) override
+      {
+        if( budget_ and budget_ < allocated_ - mark_ + charged_ + bytes )
+          {
+            throw ParseLimitError( ParseLimitError::Limit::memory, budget_, allocated_ - mark_ + charged_ + bytes );
+          }
+
+        void* ptr = upstream_->allocate( bytes, alignment );
+        allocated_ += bytes;
+        in_use_ += bytes;
+
+        return ptr;
+      }
+
+      void do_deallocate( void* ptr, std::size_t bytes, std::size_t alignment ) override
+      {
+        upstream_->deallocate( ptr, bytes, alignment );
+        in_use_ -= bytes;
+      }
+
+      bool do_is_equal( const std::pmr::memory_resource& other ) const noexcept override
+      {
+        return this == &other;
+      }
+
+    private:
+      std::pmr::memory_resource* upstream_;
+      std::size_t in_use_{0};
+      std::size_t allocated_{0};
+      std::size_t budget_{0};
+      std::size_t mark_{0};
+      std::size_t charged_{0};    // by charge() since the budget was armed
+  };
+
+  /// @Class: ArgumentVector
+  /// @Description: A null terminated argument vector, as execve() and posix_spawn() expect it.  Arguments
+  /// that were formatted live in one contiguous arena owned by this object; the others point back into
+  /// the argv that was parsed and into the parser, which must both outlive it.
+  class ArgumentVector
+  {
+    public:
+      explicit ArgumentVector( std::pmr::memory_resource* resource = std::pmr::get_default_resource()) :
+        arena_( resource ),
+        argv_( resource ) {}
+
+      int argc() const { return argv_.empty() ? 0 : static_cast<int>( argv_.size() - 1 ); }
+
+      /// @returns argc() pointers followed by a null pointer
+      char* const* argv() const { return argv_.data(); }
+
+      /// @returns The number of bytes that had to be formatted rather than reused
+      std::size_t formatted_bytes() const { return arena_.size(); }
+
+    private:
+      friend class OptionParser;
+
+      std::pmr::string arena_;
+      std::pmr::vector<char*> argv_;
+  };
+
+  /// @Struct: CachedParse
+  /// @Description: What a successful parse of a command line left in the parser, which a cache stores so
+  /// that parsing the same command line again only has to copy the values into the destinations.  See
+  /// ParseCache, in parse_options_cache.hpp, and ProcessParseCache.
+  struct CachedParse
+  {
+    struct Value
+    {
+      std::size_t option;                   // index of the option in the parser
+      int name_index;
+      int value_index;
+      std::shared_ptr<const void> value;    // as returned by OptionRecord::save()
+    };
+
+    std::string arguments;    // the raw arguments, each followed by a '\0', to rule out collisions
+    std::vector<Value> values;
+    std::vector<std::string> non_option_args;
+  };
+
+  /// @Class: ProcessParseCache
+  /// @Description: The parses of the command line of the process, one for each set of options that parsed
+  /// it, shared by all of the parsers in the process.  That command line never changes, so nothing is
+  /// evicted: entries are only ever pushed at the head of a list, and looking one up takes no lock.
+  class ProcessParseCache
+  {
+    public:
+      ProcessParseCache() = default;
+
+      ProcessParseCache( const ProcessParseCache& ) = delete;
+      ProcessParseCache& operator=( const ProcessParseCache& ) = delete;
+
+      ~ProcessParseCache()
+      {
+        for( Node* one = head_.load(); one; )
+          {
+            Node* next = one->next;
+            delete one;
+            one = next;
+          }
+      }
+
+      /// @returns The entry stored for key, or null
+      std::shared_ptr<const CachedParse> find( std::uint64_t key )
+      {
+        for( const Node* one = head_.load( std::memory_order_acquire ); one; one = one->next )
+          {
+            if( one->key == key )
+              {
+                hits_ += 1;
+                return one->entry;
+              }
+          }
+
+        misses_ += 1;
+        return nullptr;
+      }
+
+      void insert( std::uint64_t key, std::shared_ptr<const CachedParse> entry )
+      {
+        Node* node = new Node{ key, std::move( entry ), head_.load( std::memory_order_relaxed ) };
+
+        while( not head_.compare_exchange_weak( node->next, node, std::memory_order_release,
+                                                std::memory_order_relaxed ))
+          {
+          }
+      }
+
+      std::size_t hits() const { return hits_; }
+
+      std::size_t misses() const { return misses_; }
+
+    private:
+      struct Node
+      {
+        std::uint64_t key;
+        std::shared_ptr<const CachedParse> entry;
+        Node* next;
+      };
+
+      std::atomic<Node*> head_{nullptr};
+      std::atomic<std::size_t> hits_{0};
+      std::atomic<std::size_t> misses_{0};
+  };
+
+  /// @Function: type_hash
+  /// @returns A hash identifying the record type R within one program
+  template<class R>
+  std::uint64_t type_hash()
+  {
+    const char* type_name = typeid( R ).name();
+    return xxhash64( type_name, std::strlen( type_name ));
+  }
+
+  /// @Function: record_type_hash
+  /// @returns The type_hash() of the most derived type of a record
+  inline std::uint64_t record_type_hash( const OptionRecord& record )
+  {
+    const char* type_name = typeid( record ).name();
+    return xxhash64( type_name, std::strlen( type_name ));
+  }
+
+  /// @Struct: BorrowedStrings
+  /// @Description: The name and description of an option kept outside the parser, such as in a
+  /// SchemaImage, and the type_hash() of the record they were written for
+  struct BorrowedStrings
+  {
+    std::uint64_t type_hash;
+    std::string_view name;
+    std::string_view description;
+  };
+
+  /// @Class: ParserExtension
+  /// @Description: The state an opt-in header keeps for one parser, such as the options given to
+  /// require_path() in parse_options_paths.hpp, so that the core neither stores nor knows it.  The
+  /// parser creates each kind of extension the first time it is asked for one, from its own memory
+  /// resource, and calls all of them at the points below.  The protected members give the opt-in
+  /// headers the parts of the parser they work with.
+  class ParserExtension
+  {
+    public:
+      ParserExtension( const ParserExtension& ) = delete;
+      ParserExtension& operator=( const ParserExtension& ) = delete;
+
+      virtual ~ParserExtension() = default;
+
+      /// @Method: after_value
+      /// Called when the value of an option was parsed
+      /// @param option The index of the option in OptionParser::options()
+      virtual void after_value( std::size_t /* option */, const char* /* value */ ) {}
+
+      /// @Method: after_parse
+      /// Called after every successful parse, once the defaults of the options were computed
+      virtual void after_parse() {}
+
+      /// @Method: find_strings
+      /// Called before an option is added, to point it at strings that outlive the parser rather than
+      /// copy its name and description
+      /// @returns Whether strings was filled in
+      virtual bool find_strings( const std::string_view& /* name */, BorrowedStrings& /* strings */ ) const
+      {
+        return false;
+      }
+
+    protected:
+      explicit ParserExtension( OptionParser& parser ) : parser_( parser ) {}
+
+      /// @returns The index of the option named name, in full
+      /// @throws std::invalid_argument when there is none
+      std::size_t find_option( const std::string_view& name ) const;
+
+      /// @returns The resource the parser allocates from, which accounts for what the extension allocates
+      std::pmr::memory_resource* resource() const;
+
+      /// @returns The non-option arguments of the last parse, which the extension may replace
+      std::pmr::vector<std::pmr::string>& non_option_args() const;
+
+      /// @Method: value_parsed
+      /// Tell the extensions of the parser that the value of an option was parsed outside of a parse
+      void value_parsed( std::size_t option, const char* value ) const;
+
+      OptionParser& parser_;
+  };
+
+  /// @Class: OptionParser
+  /// @Description: Holds the set of options and parses the command line.  All of the storage owned by
+  /// the parser (records, names, descriptions and the non-option arguments) is drawn from the memory
+  /// resource given at construction, which defaults to std::pmr::get_default_resource().  The parser
+  /// accounts for that storage, see schema_bytes() and last_parse_bytes(), and can bound each parse
+  /// with ParseLimits when the command line comes from an untrusted source.
+  class OptionParser
+  {
+    public:
+      explicit OptionParser( const std::string_view& description = "",
+                             std::pmr::memory_resource* resource = std::pmr::get_default_resource()) :
+        accounting_( resource ),
+        description_( keep_descriptions ? description : std::string_view(), &accounting_ ),
+        option_( &accounting_ ),
+        state_( &accounting_ ),
+        defaults_( &accounting_ ),
+        index_( &accounting_ ),
+        deferred_( &accounting_ ),
+        extensions_( &accounting_ ),
+        non_option_args_( &accounting_ )
+      {
+        schema_bytes_ = accounting_.bytes_in_use();
+      }
+
+      OptionParser( const OptionParser& ) = delete;
+      OptionParser& operator=( const OptionParser& ) = delete;
+
+      ~OptionParser()
+      {
+        for( auto& one : extensions_ )    // they may refer to the options
+          {
+            one.extension->~ParserExtension();
+            accounting_.deallocate( one.extension, one.size, alignof( std::max_align_t ));
+          }
+
+        extensions_.clear();
+
+        for( auto* one : option_ )
+          {
+            std::size_t size = one->record_size();
+            one->~OptionRecord();
+            accounting_.deallocate( one, size, alignof( std::max_align_t ));
+          }
+
+        option_.clear();
+      }
+
+      /// @Method: resource
+      /// @returns The memory resource all of the parser storage is allocated from
+      std::pmr::memory_resource* resource() const { return accounting_.upstream(); }
+
+      /// @Method: schema_bytes
+      /// @returns The bytes retained by the description and the option records, their names and descriptions,
+      /// and from the first parse on, the text of the defaults that arguments() compares against
+      std::size_t schema_bytes() const { return schema_bytes_; }
+
+      /// @Method: options
+      /// @returns The options in the order they were added
+      const std::pmr::vector<OptionRecord*>& options() const { return option_; }
+
+      /// @Method: extension
+      /// @returns The extension of type E, a ParserExtension, created the first time it is asked for.  It is
+      /// allocated from the parser's resource but, like the rest of what the features keep, not counted in
+      /// schema_bytes().
+      template<class E>
+      E& extension()
+      {
+        static_assert( std::is_base_of_v<ParserExtension, E> and alignof( E ) <= alignof( std::max_align_t ));
+
+        if( E* found = find_extension<E>())
+          {
+            return *found;
+          }
+
+        void* mem = accounting_.allocate( sizeof( E ), alignof( std::max_align_t ));
+        E* created = nullptr;
+
+        try
+          {
+            created = new( mem ) E( *this );
+            extensions_.push_back( { created, sizeof( E ) } );
+          }
+        catch( ... )
+          {
+            if( created )
+              {
+                created->~E();
+              }
+            accounting_.deallocate( mem, sizeof( E ), alignof( std::max_align_t ));
+            throw;
+          }
+
+        return *created;
+      }
+
+      /// @Method: find_extension
+      /// @returns The extension of type E, or null when it was never asked for
+      template<class E>
+      const E* find_extension() const
+      {
+        for( const auto& one : extensions_ )
+          {
+            if( typeid( *one.extension ) == typeid( E ))
+              {
+                return static_cast<const E*>( one.extension );
+              }
+          }
+
+        return nullptr;
+      }
+
+      template<class E>
+      E* find_extension()
+      {
+        return const_cast<E*>( static_cast<const OptionParser&>( *this ).find_extension<E>());
+      }
+
+      /// @Method: last_parse_bytes
+      /// @returns The bytes allocated by the most recent call to parse, including one that failed
+      std::size_t last_parse_bytes() const { return last_parse_bytes_; }
+
+      /// @Method: set_limits
+      /// @param limits The budgets applied to every following call to parse
+      void set_limits( const ParseLimits& limits ) { limits_ = limits; }
+
+      const ParseLimits& limits() const { return limits_; }
+
+      /// @Method: Add an option specifying the type and name
+      /// @param T is the type for the option, either std::string, or int
+      /// @param opt_name The name of the option, minus any dashes
+      template<typename T>
+      void add( const std::string_view& opt_name,
+                const std::string_view& description,
+                T* dst_ptr )
+      {
+        add_record<ValueOption<T>>( opt_name, description, dst_ptr );
+      }
+
+      /// @Method: Add a boolean option
+      /// This is specialized version of the general add method for just booleans
+      template<>
+      void add<bool>( const std::string_view& opt_name,
+                      const std::string_view& description,
+                      bool* dst_ptr )
+      {
+        add_record<SwitchOption>( opt_name, description, dst_ptr );
+      }
+
+#if defined( PARSE_OPTIONS_HAS_MMAP )
+      /// @Method: Add an option naming a file of NUL separated arguments
+      /// The file is mapped when the option is parsed, and its arguments are read in place through dst_ptr
+      void add( const std::string_view& opt_name,
+                const std::string_view& description,
+                ArgumentFile* dst_ptr )
+      {
+        add_record<ArgumentFileOption>( opt_name, description, dst_ptr );
+      }
+#endif
+
+      /// @Method: add_deferred
+      /// Add an option whose default is expensive to compute.  compute is called only after a parse that
+      /// did not set the option, the first time that happens, and its result is stored in dst_ptr then
+      /// and after every later parse that leaves the option unset.
+      /// @param compute A callable returning the default, such as the number of cores or a cgroup limit
+      template<typename T, typename F>
+      void add_deferred( const std::string_view& opt_name, const std::string_view& description, T* dst_ptr,
+                         F&& compute )
+      {
+        add_record<DeferredOption<T>>( opt_name, description, dst_ptr );
+
+        auto* record = static_cast<DeferredOption<T>*>( option_.back());
+        record->compute_ = std::forward<F>( compute );
+        deferred_.push_back( { record, option_.size() - 1 } );
+        state_.back().default_size = not_taken;   // the destination may not be initialized, see apply_deferred
+      }
+
+      /// @Method: add_registered
+      /// Add every option declared with a RegisteredOption anywhere in the program, in name order.  Their
+      /// names and descriptions are not copied.
+      /// @throws std::invalid_argument when two of them have the same name, before adding any
+      void add_registered();
+
+      /// @Method: parse
+      /// @param argc The number of arguments as passed to main
+      /// @param argv The list of pointers to the initializers
+      /// @throws ParseLimitError when the command line exceeds one of the limits set with set_limits
+      void parse( int argc, const char* const argv[] )
+      {
+        parse_arguments( argc, argv, false );
+        finish_parse();
+      }
+
+      /// @Method: parse
+      /// Parse the command line through a cache shared with other parsers that have the same options,
+      /// such as a ParseCache from parse_options_cache.hpp.  When the same arguments were parsed before,
+      /// the values they produced are copied into the destinations without converting them again;
+      /// otherwise the command line is parsed and stored.  Either way the parser ends up in the same
+      /// state, and errors are never cached.  A parser with an option whose type cannot be copied parses
+      /// without the cache, see OptionRecord::cacheable.
+      /// @param argc The number of arguments as passed to main
+      /// @param argv The list of pointers to the initializers
+      /// @param cache The cache to consult and fill, with the find() and insert() of a ParseCache
+      template<class Cache>
+      void parse( int argc, const char* const argv[], Cache& cache )
+      {
+        parse_cached( argc, argv, cache, false );
+      }
+
+      /// @Method: parse_pass_through
+      /// Parse the options at the front of the command line and stop at the first non-option argument,
+      /// empty ones included, or at '--', which is consumed.  Nothing is added to non_option_args(); the remaining arguments
+      /// are left untouched so that a launcher can hand them to execv() as they are.
+      /// @param argc The number of arguments as passed to main
+      /// @param argv The list of pointers to the initializers
+      /// @returns The index of the first argument that was not consumed, argc when there is none.  The tail
+      /// is the argc - index pointers starting at &argv[index], and argv[argc] is still its terminator.
+      int parse_pass_through( int argc, const char* const argv[] )
+      {
+        int index = parse_arguments( argc, argv, true );
+        finish_parse();
+
+        return index;
+      }
+
+#if defined( PARSE_OPTIONS_HAS_POSIX )
+      /// @Method: parse_stream
+      /// Parse arguments read from a file descriptor, such as stdin or a pipe, as they arrive.  The input
+      /// is read in chunks of a fixed size and split on delimiter, with arguments that straddle two chunks
+      /// carried over.  Options are parsed as by parse(), and every non-option argument is handed to
+      /// on_positional instead of being kept, so memory stays bounded by the chunk size and the longest
+      /// argument whatever the size of the input.
+      /// @param fd The file descriptor to read until end of file
+      /// @param on_positional Called with a std::string_view of each non-option argument, valid for the call
+      /// @param delimiter The character between arguments, '\0' for find -print0 or xargs -0 style input
+      /// @param chunk_size The number of bytes read at a time, at least 1
+      /// @throws std::invalid_argument for errors in the arguments, when the input cannot be read or when
+      /// chunk_size is 0
+      template<typename F>
+      void parse_stream( int fd, F&& on_positional, char delimiter = '\0', std::size_t chunk_size = 64 * 1024 )
+      {
+        if( chunk_size == 0 )   // read() would return 0 at once, which looks like the end of the input
+          {
+            throw std::invalid_argument( "ERROR: the chunk size of parse_stream must be at least 1\n" );
+          }
+
+        take_defaults();
+
+        ParseAccounting accounting( *this );
+        reset_deferred();
+        reset_sources( nullptr );    // the arguments do not outlive the parse
+        StreamState state;
+
+        std::pmr::vector<char> chunk( chunk_size, &accounting_ );
+        std::pmr::string carry( &accounting_ );   // the start of an argument that continues in the next chunk
+
+        build_index();
+
+        for( ;; )
+          {
+            ssize_t num_read = ::read( fd, chunk.data(), chunk.size());
+
+            if( num_read < 0 )
+              {
+                if( errno == EINTR )
+                  {
+                    continue;
+                  }
+
+                throw std::invalid_argument( "ERROR: cannot read the argument stream\n" );
+              }
+
+            if( num_read == 0 )
+              {
+                break;
+              }
+
+            accounting.check_time();
+
+            char* pos = chunk.data();
+            char* end = pos + num_read;
+
+            while( pos < end )
+              {
+                char* next = static_cast<char*>( std::memchr( pos, delimiter, end - pos ));
+
+                if( not next )
+                  {
+                    carry.append( pos, end );
+                    break;
+                  }
+
+                *next = '\0';    // the argument is now a C string in place
+
+                if( carry.empty())
+                  {
+                    stream_token( state, std::string_view( pos, next - pos ), on_positional );
+                  }
+                else
+                  {
+                    carry.append( pos, next );
+                    stream_token( state, carry, on_positional );
+                    carry.clear();
+                  }
+
+                pos = next + 1;
+              }
+          }
+
+        if( not carry.empty())
+          {
+            stream_token( state, carry, on_positional );
+          }
+
+        if( state.pending != no_option )   // the last option is missing its value
+          {
+            option_[state.pending]->parse( nullptr );
+          }
+
+        finish_parse();
+      }
+#endif
+
+      /// @Method: parse_process_command_line
+      /// Parse the command line of the process, for code such as a shared library that has no access to
+      /// the argv given to main.  See ProcessCommandLine for where it comes from.  The parse goes through
+      /// the process-wide ProcessCommandLine::parse_cache(), so parsers with the same options share it.
+      /// @param ignore_unknown Skip the options this parser does not know, which usually belong to the
+      /// program or to other libraries.  The values of skipped options end up in non_option_args().
+      void parse_process_command_line( bool ignore_unknown = true );
+
+      /// @Method: non_option_args
+      /// @returns A vector contained all of the parameters not used as options.  It is a copy on the global
+      /// heap, made by each call; pmr_non_option_args returns them without copying
+      std::vector<std::string> non_option_args() const
+      {
+        return std::vector<std::string>( non_option_args_.begin(), non_option_args_.end());
+      }
+
+      /// @Method: pmr_non_option_args
+      /// @returns The parameters not used as options as the parser stores them, in its memory resource
+      const std::pmr::vector<std::pmr::string>& pmr_non_option_args() const { return non_option_args_; }
+
+      /// @Method: fingerprint
+      /// Hash the effective configuration: the name and current value of every option, in the order the
+      /// options were added, followed by the non-option arguments.  How an option was spelled, where it
+      /// appeared and whether it was given at all when it holds its default make no difference, so
+      /// the fingerprint can key a cache of work that depends on the configuration.  Nothing is allocated
+      /// except for values of user types whose text is long.
+      /// @returns A 64 bit xxHash of the configuration, which is not suitable where collisions can be forced
+      /// @throws std::invalid_argument when an option holds a type that cannot be hashed, see is_hashable
+      std::uint64_t fingerprint() const
+      {
+        std::uint64_t h64 = xxhash64( nullptr, 0 );
+
+        for( const auto* one : option_ )
+          {
+            h64 = xxhash64( one->name_.data(), one->name_.size(), h64 );
+            std::optional<std::uint64_t> hashed = one->hash( h64 );
+
+            if( not hashed )
+              {
+                throw std::invalid_argument( one->error_message( "value cannot be hashed, its type has neither "
+                                                                 "operator<< nor a value_converter format", "" ));
+              }
+
+            h64 = *hashed;
+          }
+
+        std::uint64_t num_args = non_option_args_.size();
+        h64 = xxhash64( &num_args, sizeof( num_args ), h64 );
+
+        for( const auto& one : non_option_args_ )
+          {
+            h64 = xxhash64( one.data(), one.size(), h64 );
+          }
+
+        return h64;
+      }
+
+      /// @Method: arguments
+      /// Build the canonical command line for the current values of the options: the program name, then
+      /// every option whose value differs from the one it had before the first parse, in the order the
+      /// options were added, then the non-option arguments.  Options that were never parsed are left out.  An option spelled out in full on the last parsed
+      /// command line and still holding the value given there reuses those arguments by pointer; only
+      /// options that were abbreviated, changed or not on the command line are formatted.
+      /// @param program The program name, by default argv[0] of the last parse
+      /// @returns An argument vector ready for execve() or posix_spawn()
+      /// @throws std::invalid_argument when an option holds a type that cannot be formatted, see format(),
+      /// or a value that would not read back, such as an empty string or one with a space, see reads_back()
+      ArgumentVector arguments( const char* program = nullptr ) const
+      {
+        ArgumentVector result( accounting_.upstream());
+        std::pmr::string& arena = result.arena_;
+
+        // The arena may move while it grows, so collect offsets into it first and pointers at the end
+
+        constexpr std::size_t reused = std::numeric_limits<std::size_t>::max();
+
+        struct Token
+        {
+          const char* source;
+          std::size_t offset;
+        };
+
+        std::pmr::vector<Token> tokens( accounting_.upstream());
+        tokens.reserve( 2 * option_.size() + non_option_args_.size() + 1 );
+
+        if( not program )
+          {
+            program = source_argv_ ? source_argv_[0] : "";
+          }
+
+        tokens.push_back( { program, reused } );
+
+        for( std::size_t ii = 0; ii < num_defaults_; ii += 1 )
+          {
+            const OptionRecord* one = option_[ii];
+            const OptionState& state = state_[ii];
+            std::size_t value_at = arena.size();
+
+            if( not one->format( arena ))
+              {
+                throw std::invalid_argument( one->error_message( "value cannot be formatted, its type has neither "
+                                                                 "operator<< nor a value_converter format", "" ));
+              }
+
+            std::string_view value( arena.data() + value_at, arena.size() - value_at );
+
+            // A deferred option whose default was never computed has no text, and is always written
+            if( value == default_text( ii ) or (not one->has_parameter() and value != "true"))
+              {
+                arena.resize( value_at );
+                continue;
+              }
+
+            if( one->has_parameter() and not one->reads_back( value ))
+              {
+                throw std::invalid_argument( one->error_message( "value cannot be read back from a command line",
+                                                                 value ));
+              }
+
+            // the value goes first in the arena, unless it can be reused or the option is a switch
+
+            Token value_token{ nullptr, value_at };
+
+            if( not one->has_parameter())
+              {
+                arena.resize( value_at );
+              }
+            else if( state.value_index and value == source_argv_[state.value_index] )
+              {
+                arena.resize( value_at );
+                value_token = { source_argv_[state.value_index], reused };
+              }
+            else
+              {
+                arena.push_back( '\0' );
+              }
+
+            // the option name
+
+            const char* name_token = state.name_index ? source_argv_[state.name_index] : nullptr;
+
+            if( name_token and std::strncmp( name_token, "--", 2 ) == 0 and one->name_ == name_token + 2 )
+              {
+                tokens.push_back( { name_token, reused } );
+              }
+            else
+              {
+                std::size_t name_at = arena.size();
+
+                arena.append( "--" );
+                arena.append( one->name_ );
+                arena.push_back( '\0' );
+
+                tokens.push_back( { nullptr, name_at } );
+              }
+
+            if( one->has_parameter())
+              {
+                tokens.push_back( value_token );
+              }
+          }
+
+        for( const auto& one : non_option_args_ )
+          {
+            tokens.push_back( { one.c_str(), reused } );
+          }
+
+        // The arena is complete, the pointers into it are now stable
+
+        result.argv_.reserve( tokens.size() + 1 );
+
+        for( const auto& one : tokens )
+          {
+            const char* arg = one.offset == reused ? one.source : arena.data() + one.offset;
+            result.argv_.push_back( const_cast<char*>( arg ));
+          }
+
+        result.argv_.push_back( nullptr );
+
+        return result;
+      }
+
+      const std::string usage() const
+      {
+        if constexpr (not keep_descriptions)    // the names only
+          {
+            std::string u_str( "OPTIONS:\n\n" );
+
+            for( const auto& one : option_ )
+              {
+                u_str.append( "  --" );
+                u_str.append( one->name());
+                u_str.append( "\n" );
+              }
+
+            return u_str;
+          }
+
+        std::string u_str( description_ );
+        u_str.append( "\n\nOPTIONS:\n\n" );
+
+        const int break_col = 20;
+
+        for( const auto& one : option_ )
+          {
+            u_str.append( "  --" );
+            u_str.append( one->name());
+
+            int num_align = break_col - (one->name().length() + 4);
+            if( 0 < num_align )
+              {
+                u_str.append( num_align, ' ' );
+              }
+            else
+              {
+                u_str.append( "\n" );
+                u_str.append( break_col, ' ' );
+              }
+            u_str.append( one->description());
+            u_str.append( "\n" );
+          }
+
+        return u_str;
+      }
+
+    protected:
+
+      /// @Method: check_token_limit
+      /// @throws ParseLimitError when there are more arguments than the limits allow
+      void check_token_limit( int argc )
+      {
+        std::size_t num_tokens = 1 < argc ? argc - 1 : 0;
+
+        if( limits_.max_tokens and limits_.max_tokens < num_tokens )
+          {
+            last_parse_bytes_ = 0;
+            throw ParseLimitError( ParseLimitError::Limit::tokens, limits_.max_tokens, num_tokens );
+          }
+      }
+
+      /// @Method: parse_cached
+      /// The cached parse behind parse( argc, argv, cache ) and parse_process_command_line
+      /// @param cache A ParseCache or the ProcessParseCache
+      /// @param ignore_unknown Skip options the parser does not know instead of throwing
+      template<class Cache>
+      void parse_cached( int argc, const char* const argv[], Cache& cache, bool ignore_unknown )
+      {
+        if( not cacheable_ )   // the values of an option cannot be stored
+          {
+            parse_arguments( argc, argv, false, ignore_unknown );
+            finish_parse();
+            return;
+          }
+
+        check_token_limit( argc );
+
+        // the key chains the arguments with their '\0', so that looking it up allocates nothing
+
+        std::uint64_t key = ignore_unknown ? xxhash64( &ignore_unknown, sizeof( ignore_unknown ), schema_hash_ )
+                                           : schema_hash_;
+
+        for( int ii = 1; ii < argc; ii += 1 )
+          {
+            key = xxhash64( argv[ii], std::strlen( argv[ii] ) + 1, key );
+          }
+
+        std::shared_ptr<const CachedParse> entry = cache.find( key );
+
+        if( entry and same_arguments( entry->arguments, argc, argv ))
+          {
+            replay( argc, argv, *entry );
+            finish_parse();
+            return;
+          }
+
+        std::size_t first_arg = non_option_args_.size();
+
+        parse_arguments( argc, argv, false, ignore_unknown );
+
+        auto stored = std::make_shared<CachedParse>();
+
+        for( int ii = 1; ii < argc; ii += 1 )
+          {
+            stored->arguments.append( argv[ii] );
+            stored->arguments.push_back( '\0' );
+          }
+
+        for( std::size_t ii = 0; ii < option_.size(); ii += 1 )
+          {
+            if( state_[ii].name_index )
+              {
+                stored->values.push_back( { ii, state_[ii].name_index, state_[ii].value_index, option_[ii]->save() } );
+              }
+          }
+
+        for( std::size_t ii = first_arg; ii < non_option_args_.size(); ii += 1 )
+          {
+            stored->non_option_args.emplace_back( non_option_args_[ii] );
+          }
+
+        cache.insert( key, std::move( stored ));
+        finish_parse();
+      }
+
+      /// @Method: same_arguments
+      /// @returns Whether arguments holds the arguments after argv[0], each followed by a '\0'
+      static bool same_arguments( std::string_view arguments, int argc, const char* const argv[] )
+      {
+        for( int ii = 1; ii < argc; ii += 1 )
+          {
+            std::size_t len = std::strlen( argv[ii] );
+
+            if( arguments.size() <= len or arguments.compare( 0, len, argv[ii] ) != 0 or arguments[len] != '\0' )
+              {
+                return false;
+              }
+
+            arguments.remove_prefix( len + 1 );
+          }
+
+        return arguments.empty();
+      }
+
+      /// @Method: replay
+      /// Bring the parser and the destinations to the state that parsing the cached command line left them in
+      void replay( int argc, const char* const argv[], const CachedParse& entry )
+      {
+        check_token_limit( argc );
+        take_defaults();
+
+        ParseAccounting accounting( *this );
+        reset_deferred();
+        reset_sources( argv );
+
+        for( const auto& one : entry.values )
+          {
+            OptionRecord* record = option_[one.option];
+
+            if( one.value_index )
+              {
+                accounting_.charge( record->value_bytes( argv[one.value_index] ));
+              }
+
+            record->restore( one.value.get());
+            state_[one.option].name_index = one.name_index;
+            state_[one.option].value_index = one.value_index;
+
+            if( one.value_index )
+              {
+                after_value( one.option, argv[one.value_index] );
+              }
+          }
+
+        for( const auto& one : entry.non_option_args )
+          {
+            non_option_args_.emplace_back( one );
+          }
+      }
+
+      /// @Method: take_defaults
+      /// Record the text of the values of the options added since the last parse, which arguments() compares
+      /// against.  It is taken at the first parse rather than in add(), where the destination may not have
+      /// been initialized yet, and it is retained with the schema.  The options of add_deferred() are left
+      /// for apply_deferred(), which takes their text once their default was computed.
+      void take_defaults()
+      {
+        for( ; num_defaults_ < option_.size(); num_defaults_ += 1 )
+          {
+            if( state_[num_defaults_].default_size != not_taken )
+              {
+                take_default( num_defaults_ );
+              }
+          }
+      }
+
+      /// @Method: take_default
+      /// Record the text of the value of one option.  Switches are not read: arguments() only writes the
+      /// ones that are set.
+      void take_default( std::size_t option )
+      {
+        std::size_t in_use = accounting_.bytes_in_use();
+        OptionState& state = state_[option];
+        state.default_at = static_cast<std::uint32_t>( defaults_.size());
+
+        if( option_[option]->has_parameter())
+          {
+            option_[option]->format( defaults_ );
+          }
+
+        state.default_size = static_cast<std::uint32_t>( defaults_.size() - state.default_at );
+        schema_bytes_ += accounting_.bytes_in_use() - in_use;
+      }
+
+      /// @Method: default_text
+      /// @returns The text of the default of an option, as take_default() found it, or nothing when it was
+      /// not taken: an option of add_deferred() that every parse so far has set
+      std::optional<std::string_view> default_text( std::size_t option ) const
+      {
+        if( state_[option].default_size == not_taken )
+          {
+            return std::nullopt;
+          }
+
+        return std::string_view( defaults_.data() + state_[option].default_at, state_[option].default_size );
+      }
+
+      /// @Method: reset_sources
+      /// Forget where the options of the previous parse came from, before a parse of argv, or of a
+      /// stream when it is null
+      void reset_sources( const char* const* argv )
+      {
+        source_argv_ = argv;
+
+        for( auto& one : state_ )
+          {
+            one.name_index = 0;
+            one.value_index = 0;
+          }
+      }
+
+      /// @Method: reset_deferred
+      /// Mark the options with computed defaults as not given, before a parse
+      void reset_deferred()
+      {
+        for( auto& one : deferred_ )
+          {
+            one.record->given_ = false;
+          }
+      }
+
+      /// @Method: apply_deferred
+      /// Compute the defaults of the options the parse did not set, and take the text of the first one
+      void apply_deferred()
+      {
+        for( auto& one : deferred_ )
+          {
+            if( not one.record->given_ )
+              {
+                one.record->apply_default();
+
+                if( state_[one.option].default_size == not_taken )
+                  {
+                    take_default( one.option );
+                  }
+              }
+          }
+      }
+
+      /// @Method: finish_parse
+      /// Fill in what depends on the whole command line once a parse succeeded
+      void finish_parse()
+      {
+        apply_deferred();
+
+        for( auto& one : extensions_ )
+          {
+            one.extension->after_parse();
+          }
+      }
+
+      /// @Method: after_value
+      /// Tell the extensions that the value of an option was parsed, for the prefetch_path() of
+      /// parse_options_prefetch.hpp
+      void after_value( std::size_t option, const char* value )
+      {
+        for( auto& one : extensions_ )
+          {
+            one.extension->after_value( option, value );
+          }
+      }
+
+      /// @Method: find_option
+      /// @returns The index of the option named opt_name, in full
+      /// @throws std::invalid_argument when there is none
+      std::size_t find_option( const std::string_view& opt_name ) const
+      {
+        for( std::size_t ii = 0; ii < option_.size(); ii += 1 )
+          {
+            if( option_[ii]->name_ == opt_name )
+              {
+                return ii;
+              }
+          }
+
+        std::string err_str( "ERROR: no such option: " );
+        err_str.append( opt_name );
+        err_str.append( "\n" );
+
+        throw std::invalid_argument( err_str );
+      }
+
+      /// @Method: build_index
+      /// Sort the options by name, the first time parse runs after options were added
+      void build_index()
+      {
+        if( index_.size() == option_.size())
+          {
+            return;
+          }
+
+        index_.resize( option_.size());
+
+        for( std::size_t ii = 0; ii < index_.size(); ii += 1 )
+          {
+            index_[ii] = static_cast<std::uint32_t>( ii );
+          }
+
+        std::sort( index_.begin(), index_.end(), [this]( std::uint32_t lhs, std::uint32_t rhs ) {
+          int cmp = option_[lhs]->name_.compare( option_[rhs]->name_ );
+          return cmp < 0 or (cmp == 0 and lhs < rhs);
+        } );
+      }
+
+      /// @Method: matching
+      /// @returns The range of the index holding the options whose names start with param
+      std::pair<const std::uint32_t*, const std::uint32_t*> matching( const std::string_view& param ) const
+      {
+        const std::uint32_t* first = index_.data();
+        const std::uint32_t* last = first + index_.size();
+
+        first = std::lower_bound( first, last, param, [this]( std::uint32_t one, const std::string_view& name ) {
+          return option_[one]->name_ < name;
+        } );
+
+        last = std::upper_bound( first, last, param, [this]( const std::string_view& name, std::uint32_t one ) {
+          return not option_[one]->matches( name ) and name < option_[one]->name_;
+        } );
+
+        return { first, last };
+      }
+
+      static constexpr std::size_t no_option = std::numeric_limits<std::size_t>::max();
+
+      struct StreamState
+      {
+        std::size_t pending{no_option};   // the index of an option waiting for its value in the next argument
+        std::size_t num_tokens{0};
+      };
+
+      /// @Method: stream_token
+      /// Parse one argument of parse_stream, which is followed by a '\0'
+      template<typename F>
+      void stream_token( StreamState& state, const std::string_view& token, F& on_positional )
+      {
+        if( token.empty() and state.pending == no_option )    // skipped as parse() does, unless it is a value
+          {
+            return;
+          }
+
+        state.num_tokens += 1;
+
+        if( limits_.max_tokens and limits_.max_tokens < state.num_tokens )
+          {
+            throw ParseLimitError( ParseLimitError::Limit::tokens, limits_.max_tokens, state.num_tokens );
+          }
+
+        if( state.pending != no_option )
+          {
+            std::size_t option = state.pending;
+            state.pending = no_option;
+            accounting_.charge( option_[option]->value_bytes( token.data()));
+            option_[option]->parse( token.data());
+            after_value( option, token.data());
+          }
+        else if( token[0] == '-' )
+          {
+            std::size_t pi = 1 < token.size() and token[1] == '-' ? 2 : 1;
+            std::string_view param = token.substr( pi );
+
+            auto range = matching( param );
+
+            if( range.first == range.second )
+              {
+                std::string err_str( "ERROR: unrecognized option: " );
+                err_str.append( token );
+                err_str.append( "\n" );
+
+                throw std::invalid_argument( err_str );
+              }
+
+            auto take = [&]( std::size_t option ) {
+              if( option_[option]->has_parameter())
+                {
+                  state.pending = option;
+                  return true;
+                }
+
+              option_[option]->parse( nullptr );
+              return false;
+            };
+
+            if( range.second - range.first == 1 )
+              {
+                take( *range.first );
+              }
+            else
+              {
+                for( std::size_t option = 0; option < option_.size(); option += 1 )    // in the order added, as parse()
+                  {
+                    if( option_[option]->matches( param ) and take( option ))
+                      {
+                        break;
+                      }
+                  }
+              }
+          }
+        else
+          {
+            on_positional( token );
+          }
+      }
+
+      /// @Method: parse_arguments
+      /// The loop shared by parse, parse_pass_through and parse_process_command_line
+      /// @param pass_through Stop at the first non-option argument or after '--' instead of collecting them
+      /// @param ignore_unknown Skip options the parser does not know instead of throwing
+      /// @returns The index of the first argument that was not consumed
+      int parse_arguments( int argc, const char* const argv[], bool pass_through, bool ignore_unknown = false )
+      {
+        check_token_limit( argc );
+        take_defaults();
+
+        ParseAccounting accounting( *this );
+        reset_deferred();
+        reset_sources( 0 < argc ? argv : nullptr );
+
+        build_index();
+
+        for( int ii = 1; ii < argc; ii += 1 )
+          {
+            accounting.check_time();
+
+            const char* pp = argv[ii];
+            size_t plen = std::strlen( pp );
+
+            if( 0 < plen )
+              {
+                int pi = 0;   // parameter index
+
+                if( pp[0] == '-' )    // this is an option
+                  {
+                    pi = 1;
+                    if( 1 < plen and pp[1] == '-' ) // check for '--'
+                      {
+                        pi = 2;
+
+                        if( pass_through and plen == 2 )    // '--' ends the options
+                          {
+                            return ii + 1;
+                          }
+                      }
+
+                    std::string_view param( &pp[pi], plen - pi );    // extract the parameter name
+
+                    // parse the value of a matching option, returns true when it took the next argument
+
+                    auto consume = [&]( std::size_t option ) {
+                      OptionRecord* one = option_[option];
+                      state_[option].name_index = ii;
+
+                      if( one->has_parameter() and ii + 1 < argc )   // extract the parameter
+                        {
+                          ii += 1;
+                          state_[option].value_index = ii;
+                          accounting_.charge( one->value_bytes( argv[ii] ));
+                          one->parse( argv[ii] );
+                          after_value( option, argv[ii] );
+                          return true;
+                        }
+
+                      one->parse( nullptr );
+                      return false;
+                    };
+
+                    // look the name up in the index; when it is a prefix of several options, loop over all
+                    // of them in the order they were added
+
+                    auto range = matching( param );
+                    bool found = range.first != range.second;
+
+                    if( range.second - range.first == 1 )
+                      {
+                        consume( *range.first );
+                      }
+                    else if( found )
+                      {
+                        for( std::size_t option = 0; option < option_.size(); option += 1 )
+                          {
+                            if( option_[option]->matches( param ) and consume( option ))
+                              {
+                                break;
+                              }
+                          }
+                      }
+
+                    if( not found and not ignore_unknown )
+                      {
+                        std::string err_str( "ERROR: unrecognized option: " );
+                        err_str.append( pp );
+                        err_str.append( "\n" );
+
+                        throw std::invalid_argument( err_str );
+                      }
+                  }
+                else if( pass_through )
+                  {
+                    return ii;
+                  }
+                else
+                  {
+                    non_option_args_.emplace_back( pp, plen );
+                  }
+              }
+            else if( pass_through )   // an empty argument is not an option, so it starts the tail
+              {
+                return ii;
+              } // else, the string is empty -- ignore it
+          } // end for loop over the arguments
+
+        return argc;
+      }
+
+      /// @Class: ParseAccounting
+      /// Arms the memory budget for the duration of one parse and records what it allocated
+      class ParseAccounting
+      {
+        public:
+          explicit ParseAccounting( OptionParser& parser ) :
+            parser_( parser ),
+            start_bytes_( parser.accounting_.bytes_allocated())
+          {
+            if( parser_.limits_.max_time.count())
+              {
+                start_time_ = std::chrono::steady_clock::now();
+              }
+
+            parser_.accounting_.arm_budget( parser_.limits_.max_bytes );
+          }
+
+          ~ParseAccounting()
+          {
+            parser_.accounting_.disarm_budget();
+            parser_.last_parse_bytes_ = parser_.accounting_.bytes_allocated() - start_bytes_;
+          }
+
+          void check_time() const
+          {
+            if( parser_.limits_.max_time.count())
+              {
+                auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                  std::chrono::steady_clock::now() - start_time_ );
+
+                if( parser_.limits_.max_time < elapsed )
+                  {
+                    throw ParseLimitError( ParseLimitError::Limit::time, parser_.limits_.max_time.count(),
+                                           elapsed.count());
+                  }
+              }
+          }
+
+        private:
+          OptionParser& parser_;
+          std::size_t start_bytes_;
+          std::chrono::steady_clock::time_point start_time_;
+      };
+
+      friend class Registration;
+      friend class ParserExtension;
+
+      /// @Struct: OptionState
+      /// What the parser keeps for each option of option_, at the same index
+      struct OptionState
+      {
+        std::uint32_t default_at{0};     // the text of the default in defaults_, taken by the first parse
+        std::uint32_t default_size{0};
+        int name_index{0};               // the argv entries of the last parse that set the option, or 0
+        int value_index{0};
+      };
+
+      static constexpr std::uint32_t not_taken = std::numeric_limits<std::uint32_t>::max();   // a default_size
+
+      /// @Struct: Deferred
+      struct Deferred
+      {
+        DeferredDefault* record;
+        std::size_t option;              // its index in option_
+      };
+
+      /// @Struct: ExtensionSlot
+      struct ExtensionSlot
+      {
+        ParserExtension* extension;
+        std::size_t size;                // allocated from accounting_
+      };
+
+      /// @Method: add_record
+      /// Construct a record of type R in memory obtained from the parser's resource
+      /// @param borrow_strings Point the record at opt_name and description, which outlive the parser,
+      /// instead of copying them
+      template<class R, typename T>
+      void add_record( const std::string_view& opt_name, const std::string_view& description, T* dst_ptr,
+                       bool borrow_strings = false )
+      {
+        const std::uint64_t record_type = type_hash<R>();
+        BorrowedStrings borrowed;
+        bool in_image = false;
+
+        for( std::size_t ii = 0; ii < extensions_.size() and not in_image; ii += 1 )
+          {
+            in_image = extensions_[ii].extension->find_strings( opt_name, borrowed );
+          }
+
+        if( in_image and borrowed.type_hash != record_type )
+          {
+            std::string err_str( "ERROR: option has a different type in the schema image: " );
+            err_str.append( opt_name );
+            err_str.append( "\n" );
+
+            throw std::invalid_argument( err_str );
+          }
+
+        std::size_t in_use = accounting_.bytes_in_use();
+        void* mem = accounting_.allocate( sizeof( R ), alignof( std::max_align_t ));
+
+        R* record = nullptr;
+
+        try
+          {
+            if( in_image )   // borrow the strings from the image
+              {
+                record = new( mem ) R( "", "", dst_ptr, &accounting_ );
+                record->name_ = borrowed.name;
+                record->description_ = keep_descriptions ? borrowed.description : std::string_view();
+              }
+            else if( borrow_strings )
+              {
+                record = new( mem ) R( "", "", dst_ptr, &accounting_ );
+                record->name_ = opt_name;
+                record->description_ = keep_descriptions ? description : std::string_view();
+              }
+            else
+              {
+                record = new( mem ) R( opt_name, description, dst_ptr, &accounting_ );
+              }
+
+            state_.emplace_back();
+            option_.push_back( record );
+
+            schema_hash_ = xxhash64( opt_name.data(), opt_name.size(), schema_hash_ );
+            schema_hash_ = xxhash64( &record_type, sizeof( record_type ), schema_hash_ );
+            cacheable_ = cacheable_ and R::cacheable;
+          }
+        catch( ... )
+          {
+            state_.resize( option_.size());
+
+            if( record )
+              {
+                record->~R();
+              }
+            accounting_.deallocate( mem, sizeof( R ), alignof( std::max_align_t ));
+            throw;
+          }
+
+        schema_bytes_ += accounting_.bytes_in_use() - in_use;
+      }
+
+      AccountingResource accounting_;   // must precede everything allocated from it
+      ParseLimits limits_;
+      std::size_t schema_bytes_{0};
+      std::size_t last_parse_bytes_{0};
+      std::size_t num_defaults_{0};               // the options of option_ whose default text was taken
+      const char* const* source_argv_{nullptr};   // the argv of the last parse
+      std::uint64_t schema_hash_{0};              // of the names and types of the options, for ParseCache
+      bool cacheable_{true};                      // whether every option can be stored in a ParseCache
+      std::pmr::string description_;
+      std::pmr::vector<OptionRecord*> option_;
+      std::pmr::vector<OptionState> state_;     // of the options of option_, at the same index
+      std::pmr::string defaults_;               // the default texts of state_, end to end
+      std::pmr::vector<std::uint32_t> index_;   // option_ sorted by name, built by the first parse
+      std::pmr::vector<Deferred> deferred_;     // the options of option_ with computed defaults
+      std::pmr::vector<ExtensionSlot> extensions_;    // created by the opt-in headers
+      std::pmr::vector<std::pmr::string> non_option_args_;
+  };
+
+  inline std::size_t ParserExtension::find_option( const std::string_view& name ) const
+  {
+    return parser_.find_option( name );
+  }
+
+  inline std::pmr::memory_resource* ParserExtension::resource() const
+  {
+    return &parser_.accounting_;
+  }
+
+  inline std::pmr::vector<std::pmr::string>& ParserExtension::non_option_args() const
+  {
+    return parser_.non_option_args_;
+  }
+
+  inline void ParserExtension::value_parsed( std::size_t option, const char* value ) const
+  {
+    parser_.after_value( option, value );
+  }
+
+  /// @Class: ProcessCommandLine
+  /// @Description: The command line of the current process, read once and shared by everyone who asks.
+  /// On Linux /proc/self/cmdline is read into a single buffer whose NUL separated arguments are used
+  /// in place, on macOS the argv given to main is used directly.
+  class ProcessCommandLine
+  {
+    public:
+      /// @returns The command line of the process, which is read the first time this is called
+      /// @throws std::invalid_argument when the command line cannot be read
+      static const ProcessCommandLine& get()
+      {
+        static const ProcessCommandLine command_line;
+        return command_line;
+      }
+
+      ProcessCommandLine( const ProcessCommandLine& ) = delete;
+      ProcessCommandLine& operator=( const ProcessCommandLine& ) = delete;
+
+      int argc() const { return static_cast<int>( argv_.size()) - 1; }
+
+      /// @returns argc() pointers followed by a null pointer
+      const char* const* argv() const { return argv_.data(); }
+
+      /// @returns The cache of the parses of the command line, shared by every parser in the process, so
+      /// that the parsers of libraries with the same options only convert the values once
+      static ProcessParseCache& parse_cache()
+      {
+        static ProcessParseCache cache;
+        return cache;
+      }
+
+    private:
+      ProcessCommandLine()
+      {
+#if defined( __linux__ )
+        std::FILE* file = std::fopen( "/proc/self/cmdline", "rb" );
+
+        if( not file )
+          {
+            throw std::invalid_argument( "ERROR: cannot read /proc/self/cmdline\n" );
+          }
+
+        char chunk[4096];
+        std::size_t num_read;
+
+        while( 0 < (num_read = std::fread( chunk, 1, sizeof( chunk ), file )))
+          {
+            buffer_.append( chunk, num_read );
+          }
+
+        std::fclose( file );
+
+        if( not buffer_.empty() and buffer_.back() != '\0' )
+          {
+            buffer_.push_back( '\0' );
+          }
+
+        // The buffer no longer changes, point at each argument in it
+
+        for( std::size_t ii = 0; ii < buffer_.size(); ii = buffer_.find( '\0', ii ) + 1 )
+          {
+            argv_.push_back( buffer_.data() + ii );
+          }
+#elif defined( __APPLE__ )
+        int argc = *_NSGetArgc();
+        char** argv = *_NSGetArgv();
+
+        argv_.assign( argv, argv + argc );
+#else
+        throw std::invalid_argument( "ERROR: the command line of the process is not available\n" );
+#endif
+        argv_.push_back( nullptr );
+      }
+
+      std::string buffer_;
+      std::vector<const char*> argv_;
+  };
+
+  inline void OptionParser::parse_process_command_line( bool ignore_unknown )
+  {
+    const ProcessCommandLine& command_line = ProcessCommandLine::get();
+
+    parse_cached( command_line.argc(), command_line.argv(), ProcessCommandLine::parse_cache(), ignore_unknown );
+  }
+
+  /// @Class: Registration
+  /// @Description: The base of options declared at namespace scope next to the code that uses them,
+  /// gflags style.  Each one links itself into a list whose head is constant initialized, so the order
+  /// in which translation units are initialized does not matter and nothing but that link happens
+  /// during static initialization.  Each one also points at the link to itself, so that it unlinks in
+  /// constant time when destroyed.  OptionParser::add_registered() adds them all to a parser.
+  class Registration
+  {
+    public:
+      Registration( const Registration& ) = delete;
+      Registration& operator=( const Registration& ) = delete;
+
+      std::string_view name() const { return name_; }
+
+      /// @returns The first registered option, the others follow through next()
+      static const Registration* first() { return head_; }
+
+      const Registration* next() const { return next_; }
+
+    protected:
+      friend class OptionParser;
+
+      /// @param name The name of the option, it must outlive the program, typically a literal
+      /// @param description The description of the option, under the same condition
+      Registration( const char* name, const char* description ) :
+        name_( name ),
+        description_( keep_descriptions ? description : "" ),
+        next_( head_ ),
+        link_( &head_ )
+      {
+        if( head_ )
+          {
+            head_->link_ = &next_;
+          }
+
+        head_ = this;
+      }
+
+      ~Registration()
+      {
+        *link_ = next_;
+
+        if( next_ )
+          {
+            next_->link_ = link_;
+          }
+      }
+
+      virtual void add_to( OptionParser& parser ) = 0;
+
+      template<typename T>
+      static void add_option( OptionParser& parser, const char* name, const char* description, T* dst_ptr )
+      {
+        if constexpr (std::is_same_v<T, bool>)
+          {
+            parser.add_record<SwitchOption>( name, description, dst_ptr, true );
+          }
+#if defined( PARSE_OPTIONS_HAS_MMAP )
+        else if constexpr (std::is_same_v<T, ArgumentFile>)
+          {
+            parser.add_record<ArgumentFileOption>( name, description, dst_ptr, true );
+          }
+#endif
+        else
+          {
+            parser.add_record<ValueOption<T>>( name, description, dst_ptr, true );
+          }
+      }
+
+      const char* name_;
+      const char* description_;
+
+    private:
+      Registration* next_;
+      Registration** link_;     // head_ or the next_ of the one before, which points at this one
+      static inline Registration* head_ = nullptr;
+  };
+
+  /// @Class: RegisteredOption
+  /// @Description: An option of type T that registers itself, and holds its value:
+  ///
+  ///   static parse_options::RegisteredOption<int> num_threads( "threads", "Worker threads", 4 );
+  ///
+  /// The value is read with *num_threads once main has parsed the command line.
+  template<typename T>
+  class RegisteredOption : public Registration
+  {
+    public:
+      RegisteredOption( const char* name, const char* description, const T& default_value = T()) :
+        Registration( name, description ),
+        value_( default_value ) {}
+
+      const T& operator*() const { return value_; }
+
+      const T* operator->() const { return &value_; }
+
+      T& value() { return value_; }
+
+    protected:
+      void add_to( OptionParser& parser ) override
+      {
+        add_option( parser, name_, description_, &value_ );
+      }
+
+    private:
+      T value_;
+  };
+
+  inline void OptionParser::add_registered()
+  {
+    std::pmr::vector<Registration*> sorted( accounting_.upstream());
+
+    for( Registration* one = Registration::head_; one; one = one->next_ )
+      {
+        sorted.push_back( one );
+      }
+
+    std::sort( sorted.begin(), sorted.end(), []( const Registration* lhs, const Registration* rhs ) {
+      return std::string_view( lhs->name_ ) < std::string_view( rhs->name_ );
+    } );
+
+    auto same = std::adjacent_find( sorted.begin(), sorted.end(), []( const Registration* lhs, const Registration* rhs ) {
+      return std::string_view( lhs->name_ ) == std::string_view( rhs->name_ );
+    } );
+
+    if( same != sorted.end())
+      {
+        std::string err_str( "ERROR: option registered twice: " );
+        err_str.append( (*same)->name_ );
+        err_str.append( "\n" );
+
+        throw std::invalid_argument( err_str );
+      }
+
+    for( auto* one : sorted )
+      {
+        one->add_to( *this );
+      }
+  }
+
+#if defined( PARSE_OPTIONS_EXTERN_TEMPLATES )
+  // The options of the common types are instantiated once, in parse_options_lib.cpp, rather than in
+  // every translation unit that adds one.  Linking with the parse_options_lib target defines this.
+
+#define PARSE_OPTIONS_INSTANCES( KEYWORD, T ) \
+  KEYWORD template class ValueOption<T>; \
+  KEYWORD template void OptionParser::add<T>( const std::string_view&, const std::string_view&, T* );
+
+  PARSE_OPTIONS_INSTANCES( extern, int )
+  PARSE_OPTIONS_INSTANCES( extern, long )
+  PARSE_OPTIONS_INSTANCES( extern, long long )
+  PARSE_OPTIONS_INSTANCES( extern, unsigned )
+  PARSE_OPTIONS_INSTANCES( extern, unsigned long )
+  PARSE_OPTIONS_INSTANCES( extern, unsigned long long )
+  PARSE_OPTIONS_INSTANCES( extern, float )
+  PARSE_OPTIONS_INSTANCES( extern, double )
+  PARSE_OPTIONS_INSTANCES( extern, std::string )
+#endif
+PARSE_OPTIONS_NAMESPACE_END
 
 #endif //PARSE_OPTIONS_HPP
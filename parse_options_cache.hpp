@@ -0,0 +1,153 @@
+/* ------------------------------------------------------------------------------
+MIT License
+
+Copyright (c) 2024 Hugo M. Ayala
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------------ */
+
+#ifndef PARSE_OPTIONS_CACHE_HPP
+#define PARSE_OPTIONS_CACHE_HPP
+
+// ParseCache, a cache of parsed command lines shared by parsers on many threads, and the parse()
+// that goes through it.  Include it, rather than parse_options.hpp, where parse( argc, argv, cache )
+// is called.
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include "parse_options.hpp"
+
+PARSE_OPTIONS_NAMESPACE_BEGIN
+  /// @Class: ParseCache
+  /// @Description: A bounded cache of parsed command lines that OptionParser::parse can consult before
+  /// doing any work.  It maps the hash of the schema and of the raw arguments to the converted values
+  /// the parse produced, so that a repeated command line only has to copy them into the destinations.
+  /// The cache is split in shards, each with its own lock and least recently used list, so that it
+  /// can be shared by parsers on many threads.  Only command lines that parsed successfully are stored.
+  class ParseCache
+  {
+    public:
+      using Entry = CachedParse;
+
+      /// @param capacity The number of command lines the cache holds before it evicts the least recently used.
+      /// A cache with no capacity stores nothing.
+      /// @param num_shards The number of independently locked parts the cache is split in, at least one and
+      /// at most capacity.  The capacity is divided among them so that the cache never holds more than it.
+      explicit ParseCache( std::size_t capacity, std::size_t num_shards = 16 ) :
+        shards_( std::max<std::size_t>( 1, std::min( num_shards, capacity )))
+      {
+        for( std::size_t ii = 0; ii < shards_.size(); ii += 1 )
+          {
+            shards_[ii].capacity = capacity / shards_.size() + (ii < capacity % shards_.size() ? 1 : 0);
+          }
+      }
+
+      /// @returns The entry stored for key, or null
+      std::shared_ptr<const Entry> find( std::uint64_t key )
+      {
+        Shard& shard = shard_for( key );
+        std::lock_guard<std::mutex> lock( shard.mutex );
+
+        auto found = shard.index.find( key );
+
+        if( found == shard.index.end())
+          {
+            shard.misses += 1;
+            return nullptr;
+          }
+
+        shard.lru.splice( shard.lru.begin(), shard.lru, found->second );
+        shard.hits += 1;
+
+        return found->second->second;
+      }
+
+      void insert( std::uint64_t key, std::shared_ptr<const Entry> entry )
+      {
+        Shard& shard = shard_for( key );
+        std::lock_guard<std::mutex> lock( shard.mutex );
+
+        auto found = shard.index.find( key );
+
+        if( found != shard.index.end())
+          {
+            found->second->second = std::move( entry );
+            shard.lru.splice( shard.lru.begin(), shard.lru, found->second );
+            return;
+          }
+
+        if( shard.capacity == 0 )
+          {
+            return;
+          }
+
+        if( shard.capacity <= shard.lru.size())
+          {
+            shard.index.erase( shard.lru.back().first );
+            shard.lru.pop_back();
+          }
+
+        shard.lru.emplace_front( key, std::move( entry ));
+        shard.index.emplace( key, shard.lru.begin());
+      }
+
+      /// @returns The number of command lines in the cache
+      std::size_t size() const { return sum( []( const Shard& shard ) { return shard.lru.size(); } ); }
+
+      std::size_t hits() const { return sum( []( const Shard& shard ) { return shard.hits; } ); }
+
+      std::size_t misses() const { return sum( []( const Shard& shard ) { return shard.misses; } ); }
+
+    private:
+      struct Shard
+      {
+        using List = std::list<std::pair<std::uint64_t, std::shared_ptr<const Entry>>>;
+
+        mutable std::mutex mutex;
+        List lru;
+        std::unordered_map<std::uint64_t, List::iterator> index;
+        std::size_t capacity{0};
+        std::size_t hits{0};
+        std::size_t misses{0};
+      };
+
+      Shard& shard_for( std::uint64_t key ) { return shards_[((key >> 32) ^ key) % shards_.size()]; }
+
+      template<typename F>
+      std::size_t sum( F count ) const
+      {
+        std::size_t total = 0;
+
+        for( const auto& one : shards_ )
+          {
+            std::lock_guard<std::mutex> lock( one.mutex );
+            total += count( one );
+          }
+
+        return total;
+      }
+
+      std::vector<Shard> shards_;
+  };
+
+PARSE_OPTIONS_NAMESPACE_END
+
+#endif //PARSE_OPTIONS_CACHE_HPP
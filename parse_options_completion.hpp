@@ -0,0 +1,755 @@
+/* ------------------------------------------------------------------------------
+MIT License
+
+Copyright (c) 2024 Hugo M. Ayala
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------------ */
+
+#ifndef PARSE_OPTIONS_COMPLETION_HPP
+#define PARSE_OPTIONS_COMPLETION_HPP
+
+// Shell completion: the bash, zsh and fish scripts of completion_script(), and the
+// CompletionServer that answers queries from a resident parser over a Unix domain socket.
+
+#include <mutex>
+
+#include "parse_options.hpp"
+
+#if defined( PARSE_OPTIONS_HAS_POSIX )
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+PARSE_OPTIONS_NAMESPACE_BEGIN
+  /// @Enum: CompletionShell
+  /// @Description: The shells completion_script() writes scripts for
+  enum class CompletionShell
+  {
+    bash,
+    zsh,
+    fish
+  };
+
+  /// @Class: CompletionIndex
+  /// @Description: A snapshot of the names and value types of the options of a parser, sorted by name,
+  /// that answers completion queries.  It does not refer to the parser, so once built it can be read
+  /// from any thread while the parser changes; see completion_index().
+  class CompletionIndex
+  {
+    public:
+      struct Entry
+      {
+        std::string name;
+        std::string value_type;   // empty for an option that takes no value
+        std::size_t order;        // the position of the option in the order it was added
+      };
+
+      explicit CompletionIndex( std::vector<Entry> entries ) : entries_( std::move( entries ))
+      {
+        std::sort( entries_.begin(), entries_.end(), []( const Entry& lhs, const Entry& rhs ) {
+          int cmp = lhs.name.compare( rhs.name );
+          return cmp < 0 or (cmp == 0 and lhs.order < rhs.order);
+        } );
+      }
+
+      /// @Method: complete
+      /// Answer a completion query with the prefix rules of parse.  When previous names an option that
+      /// takes a value, the reply is '=' and the value_type() of the first such option in the order they
+      /// were added.  Otherwise, when current starts with '-', the reply lists the options it is a prefix
+      /// of, sorted, as "--name".  Each line ends with '\n'.
+      /// @param previous The word before the one being completed
+      /// @param current The word being completed, up to the cursor
+      std::string complete( const std::string_view& previous, const std::string_view& current ) const
+      {
+        auto param = []( const std::string_view& word ) {
+          return word.substr( 1 < word.size() and word[1] == '-' ? 2 : 1 );
+        };
+
+        std::string reply;
+
+        if( 1 < previous.size() and previous[0] == '-' and previous != "--" )
+          {
+            auto range = matching( param( previous ));
+            const Entry* best = nullptr;
+
+            for( const Entry* it = range.first; it != range.second; ++it )
+              {
+                if( not it->value_type.empty() and (not best or it->order < best->order))
+                  {
+                    best = it;
+                  }
+              }
+
+            if( best )
+              {
+                reply.push_back( '=' );
+                reply.append( best->value_type );
+                reply.push_back( '\n' );
+
+                return reply;
+              }
+          }
+
+        if( not current.empty() and current[0] == '-' )
+          {
+            auto range = matching( param( current ));
+
+            for( const Entry* it = range.first; it != range.second; ++it )
+              {
+                reply.append( "--" );
+                reply.append( it->name );
+                reply.push_back( '\n' );
+              }
+          }
+
+        return reply;
+      }
+
+    private:
+      /// @returns The range of the entries whose names start with param
+      std::pair<const Entry*, const Entry*> matching( const std::string_view& param ) const
+      {
+        const Entry* first = entries_.data();
+        const Entry* last = first + entries_.size();
+
+        first = std::lower_bound( first, last, param, []( const Entry& one, const std::string_view& name ) {
+          return one.name < name;
+        } );
+
+        last = std::find_if( first, last, [&param]( const Entry& one ) {
+          return one.name.compare( 0, param.size(), param ) != 0;
+        } );
+
+        return { first, last };
+      }
+
+      std::vector<Entry> entries_;
+  };
+
+  /// @Function: completion_script
+  /// Write a completion script that holds the options of parser, so completing a command line never
+  /// runs the program.  The options are sorted by name and, as parse() does, any prefix of a name stands
+  /// for the options it starts; after an option that takes a value, files are offered unless the value
+  /// is a number.  Install the result where the shell looks for completions, for example with:
+  /// program --completion bash > /etc/bash_completion.d/program
+  /// @param shell The shell to write the script for
+  /// @param program The name of the command the script completes
+  inline std::string completion_script( const OptionParser& parser, CompletionShell shell,
+                                        const std::string_view& program )
+  {
+    const auto& option = parser.options();
+    std::vector<std::uint32_t> sorted( option.size());
+
+    for( std::size_t ii = 0; ii < sorted.size(); ii += 1 )
+      {
+        sorted[ii] = static_cast<std::uint32_t>( ii );
+      }
+
+    std::sort( sorted.begin(), sorted.end(), [&option]( std::uint32_t lhs, std::uint32_t rhs ) {
+      int cmp = option[lhs]->name().compare( option[rhs]->name() );
+      return cmp < 0 or (cmp == 0 and lhs < rhs);
+    } );
+
+    // program with anything but letters, digits and '_' replaced, to name shell functions and variables
+
+    std::string id( "_" );
+
+    for( char ch : program )
+      {
+        id.push_back( std::isalnum( static_cast<unsigned char>( ch )) ? ch : '_' );
+      }
+
+    // a single quoted shell word
+
+    auto quoted = []( std::string& out, const std::string_view& text ) {
+      out.push_back( '\'' );
+
+      for( char ch : text )
+        {
+          if( ch == '\'' )
+            {
+              out.append( "'\\''" );
+            }
+          else
+            {
+              out.push_back( ch );
+            }
+        }
+
+      out.push_back( '\'' );
+    };
+
+    auto is_number = []( const std::string_view& type ) { return type == "int" or type == "float"; };
+
+    std::string script;
+
+    if( shell == CompletionShell::bash )
+      {
+        script.append( "# bash completion for " ).append( program ).append( ", generated by parse_options\n\n" );
+
+        // three tables sorted by name: the names, the kinds of value and the order the options were added in
+
+        const char* table[] = { "_options=(", "_types=(", "_order=(" };
+
+        for( int column = 0; column < 3; column += 1 )
+          {
+            script.append( id ).append( table[column] );
+
+            for( auto ii : sorted )
+              {
+                script.push_back( ' ' );
+
+                if( column == 0 )
+                  {
+                    quoted( script, option[ii]->name() );
+                  }
+                else if( column == 1 )
+                  {
+                    script.append( option[ii]->value_type());
+                  }
+                else
+                  {
+                    script.append( std::to_string( ii ));
+                  }
+              }
+
+            script.append( " )\n" );
+          }
+
+        script.append( "\n" ).append( id ).append( "_complete()\n{\n" );
+        script.append( "  local cur=\"${COMP_WORDS[COMP_CWORD]}\" prev=\"${COMP_WORDS[COMP_CWORD-1]}\"\n" );
+        script.append( "  local ii name best=-1 found=0\n\n" );
+        script.append( "  COMPREPLY=()\n\n" );
+
+        // the value of the first option, in the order they were added, that the previous word names
+
+        script.append( "  if [[ $COMP_CWORD -gt 1 && \"$prev\" == -?* && \"$prev\" != -- ]]; then\n" );
+        script.append( "    name=\"${prev#-}\"; name=\"${name#-}\"\n" );
+        script.append( "    for (( ii = 0; ii < ${#" ).append( id ).append( "_options[@]}; ii++ )); do\n" );
+        script.append( "      if [[ \"${" ).append( id ).append( "_options[ii]}\" == \"$name\"* && \"${" ).append( id );
+        script.append( "_types[ii]}\" != switch ]]; then\n" );
+        script.append( "        (( best < 0 || " ).append( id ).append( "_order[ii] < " ).append( id );
+        script.append( "_order[best] )) && best=$ii\n" );
+        script.append( "      fi\n    done\n" );
+        script.append( "    if (( best >= 0 )); then\n" );
+        script.append( "      case \"${" ).append( id ).append( "_types[best]}\" in\n" );
+        script.append( "        int|float) ;;\n" );
+        script.append( "        *) COMPREPLY=( $(compgen -f -- \"$cur\") ) ;;\n" );
+        script.append( "      esac\n      return 0\n    fi\n  fi\n\n" );
+
+        // the options a prefix names, which are next to each other in the sorted table
+
+        script.append( "  if [[ \"$cur\" == -* ]]; then\n" );
+        script.append( "    name=\"${cur#-}\"; name=\"${name#-}\"\n" );
+        script.append( "    for (( ii = 0; ii < ${#" ).append( id ).append( "_options[@]}; ii++ )); do\n" );
+        script.append( "      if [[ \"${" ).append( id ).append( "_options[ii]}\" == \"$name\"* ]]; then\n" );
+        script.append( "        COMPREPLY+=( \"--${" ).append( id ).append( "_options[ii]}\" ); found=1\n" );
+        script.append( "      elif (( found )); then\n        break\n      fi\n    done\n" );
+        script.append( "    return 0\n  fi\n\n" );
+        script.append( "  COMPREPLY=( $(compgen -f -- \"$cur\") )\n}\n\n" );
+        script.append( "complete -F " ).append( id ).append( "_complete " ).append( program ).append( "\n" );
+      }
+    else if( shell == CompletionShell::zsh )
+      {
+        script.append( "#compdef " ).append( program ).append( "\n# generated by parse_options\n\n" );
+        script.append( "_arguments" );
+
+        for( auto ii : sorted )
+          {
+            const OptionRecord* one = option[ii];
+            std::string spec( "--" );
+            spec.append( one->name() ).push_back( '[' );
+
+            for( char ch : one->description() )    // the description ends at the first unescaped ']'
+              {
+                if( ch == '[' or ch == ']' or ch == ':' or ch == '\\' )
+                  {
+                    spec.push_back( '\\' );
+                  }
+
+                spec.push_back( ch == '\n' ? ' ' : ch );
+              }
+
+            spec.push_back( ']' );
+
+            std::string_view type = one->value_type();
+
+            if( type != "switch" )
+              {
+                spec.push_back( ':' );
+                spec.append( type ).append( is_number( type ) ? ": " : ":_files" );
+              }
+
+            script.append( " \\\n  " );
+            quoted( script, spec );
+          }
+
+        script.append( " \\\n  '*:argument:_files'\n" );
+      }
+    else
+      {
+        script.append( "# fish completion for " ).append( program ).append( ", generated by parse_options\n\n" );
+
+        for( auto ii : sorted )
+          {
+            const OptionRecord* one = option[ii];
+            std::string_view type = one->value_type();
+
+            script.append( "complete -c " ).append( program ).append( " -l " );
+            quoted( script, one->name() );
+
+            if( type != "switch" )
+              {
+                script.append( is_number( type ) ? " -x" : " -r -F" );
+              }
+
+            if( not one->description().empty())
+              {
+                std::string description( one->description() );
+                std::replace( description.begin(), description.end(), '\n', ' ' );
+
+                script.append( " -d " );
+                quoted( script, description );
+              }
+
+            script.append( "\n" );
+          }
+      }
+
+    return script;
+  }
+
+  /// @Function: completion_index
+  /// @returns A snapshot of the options of parser for answering completion queries, which stays valid
+  /// and unchanged when options are added later
+  inline CompletionIndex completion_index( const OptionParser& parser )
+  {
+    const auto& option = parser.options();
+    std::vector<CompletionIndex::Entry> entries;
+    entries.reserve( option.size());
+
+    for( std::size_t ii = 0; ii < option.size(); ii += 1 )
+      {
+        const OptionRecord* one = option[ii];
+        entries.push_back( { std::string( one->name() ),
+                             one->has_parameter() ? std::string( one->value_type()) : std::string(), ii } );
+      }
+
+    return CompletionIndex( std::move( entries ));
+  }
+
+  /// @Class: CompletionCache
+  /// @Description: The completion_index() of a parser, kept for complete() and built again only after
+  /// options were added
+  class CompletionCache final : public ParserExtension
+  {
+    public:
+      explicit CompletionCache( OptionParser& parser ) : ParserExtension( parser ) {}
+
+      /// @Method: index
+      const CompletionIndex& index()
+      {
+        if( not index_ or num_options_ != parser_.options().size())
+          {
+            index_.emplace( completion_index( parser_ ));
+            num_options_ = parser_.options().size();
+          }
+
+        return *index_;
+      }
+
+    private:
+      std::optional<CompletionIndex> index_;
+      std::size_t num_options_{0};   // when index_ was built
+  };
+
+  /// @Function: complete
+  /// Answer a completion query for the options added to parser so far, see CompletionIndex::complete.
+  /// The index is kept on the parser between queries.
+  inline std::string complete( OptionParser& parser, const std::string_view& previous,
+                               const std::string_view& current )
+  {
+    return parser.extension<CompletionCache>().index().complete( previous, current );
+  }
+
+#if defined( PARSE_OPTIONS_HAS_POSIX )
+#if defined( MSG_NOSIGNAL )
+  constexpr int completion_send_flags = MSG_NOSIGNAL;   // a closed connection fails the send instead of raising SIGPIPE
+#else
+  constexpr int completion_send_flags = 0;
+#endif
+#if defined( SOCK_CLOEXEC )
+  constexpr int completion_socket_type = SOCK_STREAM | SOCK_CLOEXEC;
+#else
+  constexpr int completion_socket_type = SOCK_STREAM;
+#endif
+
+  /// @Class: CompletionServer
+  /// @Description: Keeps a snapshot of the options of a parser resident and answers completion queries
+  /// over a Unix domain socket, for programs whose options change at run time, such as with plugins,
+  /// where a generated completion script would go stale.  A query is one line, the word before the
+  /// cursor and the word being completed separated by a tab; the reply is CompletionIndex::complete()
+  /// followed by an empty line.  Connections are kept open for any number of queries, and one thread
+  /// serves them all with poll() on non-blocking sockets, queueing the replies a client is slow to
+  /// read, so a query costs a round trip and a lookup in the sorted index.  The serving thread never
+  /// reads the parser: the thread that adds options calls update() to publish a new snapshot.
+  class CompletionServer
+  {
+    public:
+      /// @param parser The parser with the options to complete, whose options are copied
+      /// @param path The path of the socket, which is replaced if it exists
+      /// @throws std::invalid_argument when the socket cannot be created
+      CompletionServer( const OptionParser& parser, const std::string& path ) :
+        index_( std::make_shared<const CompletionIndex>( completion_index( parser ))), path_( path )
+      {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+
+        if( sizeof( address.sun_path ) <= path.size())
+          {
+            throw std::invalid_argument( "ERROR: socket path too long: " + path + "\n" );
+          }
+
+        std::memcpy( address.sun_path, path.c_str(), path.size() + 1 );
+        ::unlink( path.c_str());
+
+        listen_fd_ = ::socket( AF_UNIX, completion_socket_type, 0 );
+
+        if( listen_fd_ < 0 or not set_non_blocking( listen_fd_ )
+            or ::bind( listen_fd_, reinterpret_cast<sockaddr*>( &address ), sizeof( address )) != 0
+            or ::listen( listen_fd_, SOMAXCONN ) != 0 or ::pipe( wake_ ) != 0 )
+          {
+            std::string err_str( "ERROR: cannot listen on " + path + ": " + std::strerror( errno ) + "\n" );
+
+            if( 0 <= listen_fd_ )
+              {
+                ::close( listen_fd_ );
+              }
+
+            throw std::invalid_argument( err_str );
+          }
+      }
+
+      CompletionServer( const CompletionServer& ) = delete;
+      CompletionServer& operator=( const CompletionServer& ) = delete;
+
+      ~CompletionServer()
+      {
+        for( auto& one : clients_ )
+          {
+            ::close( one.fd );
+          }
+
+        ::close( listen_fd_ );
+        ::close( wake_[0] );
+        ::close( wake_[1] );
+        ::unlink( path_.c_str());
+      }
+
+      /// @Method: update
+      /// Answer the following queries from the options the parser has now, after options were added.
+      /// Call it from the thread that changes the parser; the snapshot is built there.
+      void update( const OptionParser& parser )
+      {
+        auto index = std::make_shared<const CompletionIndex>( completion_index( parser ));
+
+        std::lock_guard<std::mutex> lock( index_mutex_ );
+        index_ = std::move( index );
+      }
+
+      /// @Method: serve
+      /// Answer queries until stop() is called
+      void serve()
+      {
+        std::vector<pollfd> fds;
+        char buffer[4096];
+
+        for( ;; )
+          {
+            fds.clear();
+            fds.push_back( { wake_[0], POLLIN, 0 } );
+            fds.push_back( { listen_fd_, POLLIN, 0 } );
+
+            for( const auto& one : clients_ )
+              {
+                // a client that does not read its replies is not read from until it catches up
+
+                short events = one.outgoing.size() < max_pending ? POLLIN : 0;
+
+                if( not one.outgoing.empty())
+                  {
+                    events |= POLLOUT;
+                  }
+
+                fds.push_back( { one.fd, events, 0 } );
+              }
+
+            if( ::poll( fds.data(), fds.size(), -1 ) < 0 )
+              {
+                if( errno == EINTR )
+                  {
+                    continue;
+                  }
+
+                throw std::invalid_argument( std::string( "ERROR: poll failed: " ) + std::strerror( errno ) + "\n" );
+              }
+
+            if( fds[0].revents )
+              {
+                return;
+              }
+
+            if( fds[1].revents & POLLIN )
+              {
+                int fd = ::accept( listen_fd_, nullptr, nullptr );
+
+                if( 0 <= fd and set_non_blocking( fd ))
+                  {
+                    clients_.push_back( { fd, {}, {} } );
+                  }
+                else if( 0 <= fd )
+                  {
+                    ::close( fd );
+                  }
+              }
+
+            // the clients polled are the first fds.size() - 2, those accepted above come after them
+
+            for( std::size_t ii = fds.size(); 2 < ii--; )
+              {
+                short revents = fds[ii].revents;
+
+                if( not revents )
+                  {
+                    continue;
+                  }
+
+                Client& client = clients_[ii - 2];
+                bool keep = not (revents & (POLLERR | POLLNVAL));
+
+                if( keep and (revents & POLLIN))
+                  {
+                    ssize_t num_read = ::read( client.fd, buffer, sizeof( buffer ));
+
+                    if( num_read < 0 )
+                      {
+                        keep = errno == EAGAIN or errno == EWOULDBLOCK or errno == EINTR;
+                      }
+                    else
+                      {
+                        keep = 0 < num_read and answer( client, std::string_view( buffer, num_read ));
+                      }
+                  }
+                else if( revents & POLLHUP )
+                  {
+                    keep = false;
+                  }
+
+                if( keep and not client.outgoing.empty())
+                  {
+                    keep = flush( client );
+                  }
+
+                if( not keep )
+                  {
+                    ::close( client.fd );
+                    clients_.erase( clients_.begin() + (ii - 2));
+                  }
+              }
+          }
+      }
+
+      /// @Method: stop
+      /// Make serve() return, from another thread or from a signal handler
+      void stop()
+      {
+        char one = 0;
+        ssize_t ignored = ::write( wake_[1], &one, 1 );
+        (void) ignored;
+      }
+
+      /// @returns The number of queries answered
+      std::size_t queries() const { return queries_; }
+
+    private:
+      static constexpr std::size_t max_pending = 64 * 1024;   // of a query, or of replies not yet sent
+
+      struct Client
+      {
+        int fd;
+        std::string pending;    // the start of a query that has not been read in full
+        std::string outgoing;   // replies the socket did not take yet
+      };
+
+      static bool set_non_blocking( int fd )
+      {
+        int flags = ::fcntl( fd, F_GETFL );
+        return 0 <= flags and ::fcntl( fd, F_SETFL, flags | O_NONBLOCK ) == 0;
+      }
+
+      /// @returns False when the connection should be closed
+      bool answer( Client& client, const std::string_view& data )
+      {
+        client.pending.append( data );
+
+        if( max_pending < client.pending.size())    // not a query
+          {
+            return false;
+          }
+
+        std::shared_ptr<const CompletionIndex> index;
+
+        {
+          std::lock_guard<std::mutex> lock( index_mutex_ );
+          index = index_;
+        }
+
+        std::size_t start = 0;
+
+        for( std::size_t end; (end = client.pending.find( '\n', start )) != std::string::npos; start = end + 1 )
+          {
+            std::string_view query( client.pending.data() + start, end - start );
+            std::size_t tab = query.find( '\t' );
+
+            if( tab != std::string_view::npos )
+              {
+                client.outgoing.append( index->complete( query.substr( 0, tab ), query.substr( tab + 1 )));
+              }
+
+            client.outgoing.push_back( '\n' );
+            queries_ += 1;
+          }
+
+        client.pending.erase( 0, start );
+
+        return true;
+      }
+
+      /// @returns False when the connection should be closed
+      static bool flush( Client& client )
+      {
+        std::size_t pos = 0;
+
+        while( pos < client.outgoing.size())
+          {
+            ssize_t num_written = ::send( client.fd, client.outgoing.data() + pos, client.outgoing.size() - pos,
+                                          completion_send_flags );
+
+            if( num_written < 0 and (errno == EAGAIN or errno == EWOULDBLOCK or errno == EINTR))
+              {
+                break;    // the rest goes when poll() reports the socket writable
+              }
+
+            if( num_written <= 0 )
+              {
+                return false;
+              }
+
+            pos += num_written;
+          }
+
+        client.outgoing.erase( 0, pos );
+
+        return true;
+      }
+
+      std::mutex index_mutex_;
+      std::shared_ptr<const CompletionIndex> index_;
+      std::string path_;
+      int listen_fd_{-1};
+      int wake_[2]{-1, -1};
+      std::vector<Client> clients_;
+      std::size_t queries_{0};
+  };
+
+  /// @Class: CompletionClient
+  /// @Description: A connection to a CompletionServer, kept open for any number of queries
+  class CompletionClient
+  {
+    public:
+      /// @throws std::invalid_argument when the server cannot be reached
+      explicit CompletionClient( const std::string& path )
+      {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::strncpy( address.sun_path, path.c_str(), sizeof( address.sun_path ) - 1 );
+
+        fd_ = ::socket( AF_UNIX, completion_socket_type, 0 );
+
+        if( fd_ < 0 or ::connect( fd_, reinterpret_cast<sockaddr*>( &address ), sizeof( address )) != 0 )
+          {
+            std::string err_str( "ERROR: cannot connect to " + path + ": " + std::strerror( errno ) + "\n" );
+
+            if( 0 <= fd_ )
+              {
+                ::close( fd_ );
+              }
+
+            throw std::invalid_argument( err_str );
+          }
+      }
+
+      CompletionClient( const CompletionClient& ) = delete;
+      CompletionClient& operator=( const CompletionClient& ) = delete;
+
+      ~CompletionClient() { ::close( fd_ ); }
+
+      /// @Method: query
+      /// @returns The reply of the server without the empty line that ends it
+      /// @throws std::invalid_argument when the connection fails
+      std::string query( const std::string_view& previous, const std::string_view& current )
+      {
+        std::string request( previous );
+        request.push_back( '\t' );
+        request.append( current );
+        request.push_back( '\n' );
+
+        if( ::send( fd_, request.data(), request.size(), completion_send_flags ) != static_cast<ssize_t>( request.size()))
+          {
+            throw std::invalid_argument( "ERROR: completion query failed\n" );
+          }
+
+        std::string reply;
+        char buffer[4096];
+
+        while( not (reply == "\n" or (1 < reply.size() and reply.compare( reply.size() - 2, 2, "\n\n" ) == 0)))
+          {
+            ssize_t num_read = ::read( fd_, buffer, sizeof( buffer ));
+
+            if( num_read <= 0 )
+              {
+                throw std::invalid_argument( "ERROR: completion query failed\n" );
+              }
+
+            reply.append( buffer, num_read );
+          }
+
+        reply.pop_back();
+        return reply;
+      }
+
+    private:
+      int fd_{-1};
+  };
+#endif
+PARSE_OPTIONS_NAMESPACE_END
+
+#endif //PARSE_OPTIONS_COMPLETION_HPP
@@ -0,0 +1,331 @@
+/* ------------------------------------------------------------------------------
+MIT License
+
+Copyright (c) 2024 Hugo M. Ayala
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------------ */
+
+#ifndef PARSE_OPTIONS_DERIVED_HPP
+#define PARSE_OPTIONS_DERIVED_HPP
+
+// add_derived(), for settings computed from other settings, which the parser brings up to date after
+// every parse, computing them on a pool of threads with set_derive_threads().
+
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "parse_options.hpp"
+
+PARSE_OPTIONS_NAMESPACE_BEGIN
+  /// @Class: DerivedNode
+  /// @Description: A value computed from options and from other derived values after each parse.  The
+  /// parser keeps the hash of the inputs it was last computed from, and of the value it produced, so
+  /// that a node is only computed again when one of its inputs changed.  An input whose type cannot be
+  /// hashed, see is_hashable, counts as changed every time.
+  class DerivedNode
+  {
+    public:
+      virtual ~DerivedNode() = default;
+
+      std::string_view name() const { return name_; }
+
+      /// @Method: node_size
+      /// @returns The size of the most derived node, so the graph can return it to the parser's resource
+      virtual std::size_t node_size() const = 0;
+
+    protected:
+      explicit DerivedNode( const std::string_view& name, std::pmr::memory_resource* resource ) :
+        name_( name, resource ), options_( resource ), inputs_( resource ) {}
+
+      /// @Method: compute
+      /// Compute and store the value
+      /// @returns The hash of the new value
+      virtual std::uint64_t compute() = 0;
+
+      std::pmr::string name_;
+      std::pmr::vector<const OptionRecord*> options_;   // the options it is computed from
+      std::pmr::vector<const DerivedNode*> inputs_;     // and the derived values, all added before it
+      std::uint64_t input_hash_{0};
+      std::uint64_t value_hash_{0};
+      std::size_t level_{0};                            // 1 + the highest level of its derived inputs
+      bool computed_{false};
+
+      friend class DerivedGraph;
+  };
+
+  /// @Class: DerivedValue
+  /// @Description: A DerivedNode that stores the result of a callable in a destination of type T
+  template<class T, class F>
+  class DerivedValue : public DerivedNode
+  {
+    public:
+      DerivedValue( const std::string_view& name, T* dst_ptr, F compute, std::pmr::memory_resource* resource ) :
+        DerivedNode( name, resource ), dst_ptr_( dst_ptr ), compute_( std::move( compute )) {}
+
+      std::size_t node_size() const override { return sizeof( *this ); }
+
+    protected:
+      std::uint64_t compute() override
+      {
+        *dst_ptr_ = compute_();
+
+        if constexpr (is_hashable<T>::value)
+          {
+            return hash_value( *dst_ptr_, 0 );
+          }
+        else
+          {
+            return value_hash_ + 1;   // a new hash every time, so the values derived from it are computed again
+          }
+      }
+
+      T* dst_ptr_;
+      F compute_;
+  };
+
+  /// @Class: DerivedGraph
+  /// @Description: The derived values of a parser, each after the nodes it depends on, which the parser
+  /// brings up to date after every parse.  The nodes are allocated from the parser's resource.
+  class DerivedGraph final : public ParserExtension
+  {
+    public:
+      explicit DerivedGraph( OptionParser& parser ) :
+        ParserExtension( parser ),
+        nodes_( resource())
+      {}
+
+      DerivedGraph( const DerivedGraph& ) = delete;
+      DerivedGraph& operator=( const DerivedGraph& ) = delete;
+
+      ~DerivedGraph()
+      {
+        for( auto* one : nodes_ )
+          {
+            std::size_t size = one->node_size();
+            one->~DerivedNode();
+            resource()->deallocate( one, size, alignof( std::max_align_t ));
+          }
+      }
+
+      void after_parse() override { update(); }
+
+      /// @Method: add
+      /// Add a derived value, see add_derived()
+      template<typename T, typename F>
+      void add( const std::string_view& name, T* dst_ptr, std::initializer_list<std::string_view> inputs, F&& compute )
+      {
+        using Node = DerivedValue<T, std::decay_t<F>>;
+
+        void* mem = resource()->allocate( sizeof( Node ), alignof( std::max_align_t ));
+        Node* node = nullptr;
+
+        try
+          {
+            node = new( mem ) Node( name, dst_ptr, std::forward<F>( compute ), resource());
+
+            for( const auto& input : inputs )
+              {
+                auto derived = std::find_if( nodes_.begin(), nodes_.end(), [&]( const auto* one ) {
+                  return one->name_ == input;
+                } );
+
+                if( derived == nodes_.end())    // then it has to be an option
+                  {
+                    node->options_.push_back( parser_.options()[find_option( input )] );
+                    continue;
+                  }
+
+                node->inputs_.push_back( *derived );
+                node->level_ = std::max( node->level_, (*derived)->level_ + 1 );
+              }
+
+            nodes_.push_back( node );
+          }
+        catch( ... )
+          {
+            if( node )
+              {
+                node->~Node();
+              }
+            resource()->deallocate( mem, sizeof( Node ), alignof( std::max_align_t ));
+            throw;
+          }
+      }
+
+      /// @Method: set_threads
+      void set_threads( unsigned num_threads ) { num_threads_ = std::max( 1u, num_threads ); }
+
+      /// @Method: update
+      /// Compute the values whose inputs changed, one level of dependencies at a time
+      /// @returns The number of values computed
+      std::size_t update()
+      {
+        std::size_t num_computed = 0;
+        std::pmr::vector<DerivedNode*> dirty( resource());
+
+        for( std::size_t level = 0; ; level += 1 )
+          {
+            bool more = false;
+            dirty.clear();
+
+            for( auto* node : nodes_ )
+              {
+                if( node->level_ != level )
+                  {
+                    more = more or level < node->level_;
+                    continue;
+                  }
+
+                std::uint64_t input_hash = 0;
+                bool changed = not node->computed_;
+
+                for( const auto* one : node->options_ )
+                  {
+                    std::optional<std::uint64_t> hashed = one->hash( input_hash );
+
+                    // an option that cannot be hashed may have changed whatever it holds
+
+                    changed = changed or not hashed;
+                    input_hash = hashed.value_or( input_hash );
+                  }
+
+                for( const auto* one : node->inputs_ )
+                  {
+                    input_hash = xxhash64( &one->value_hash_, sizeof( one->value_hash_ ), input_hash );
+                  }
+
+                if( changed or input_hash != node->input_hash_ )
+                  {
+                    node->input_hash_ = input_hash;
+                    dirty.push_back( node );
+                  }
+              }
+
+            compute( dirty );
+            num_computed += dirty.size();
+
+            if( not more )
+              {
+                return num_computed;
+              }
+          }
+      }
+
+    private:
+      /// @Method: compute
+      /// Compute derived values that do not depend on each other, on a pool of threads when there are several
+      void compute( const std::pmr::vector<DerivedNode*>& nodes )
+      {
+        auto compute_one = []( DerivedNode* node ) {
+          node->value_hash_ = node->compute();
+          node->computed_ = true;
+        };
+
+        if( num_threads_ == 1 or nodes.size() < 2 )
+          {
+            for( auto* node : nodes )
+              {
+                compute_one( node );
+              }
+
+            return;
+          }
+
+        std::atomic<std::size_t> next{0};
+        std::exception_ptr error;
+        std::mutex error_mutex;
+
+        auto work = [&]() {
+          for( std::size_t ii = next++; ii < nodes.size(); ii = next++ )
+            {
+              try
+                {
+                  compute_one( nodes[ii] );
+                }
+              catch( ... )
+                {
+                  std::lock_guard<std::mutex> lock( error_mutex );
+                  error = error ? error : std::current_exception();
+                }
+            }
+        };
+
+        std::pmr::vector<std::thread> pool( resource());
+
+        for( unsigned ii = 1; ii < num_threads_ and ii < nodes.size(); ii += 1 )
+          {
+            pool.emplace_back( work );
+          }
+
+        work();
+
+        for( auto& one : pool )
+          {
+            one.join();
+          }
+
+        if( error )
+          {
+            std::rethrow_exception( error );
+          }
+      }
+
+      std::pmr::vector<DerivedNode*> nodes_;   // owned, in the order they were added
+      unsigned num_threads_{1};
+  };
+
+  /// @Function: add_derived
+  /// Add a value computed from other settings, such as a buffer size from the number of threads and
+  /// a memory limit.  After every parse the derived values are brought up to date in dependency
+  /// order, and a value is computed again only when one of its inputs changed since it last was.
+  /// @param name The name other derived values use to refer to this one
+  /// @param dst_ptr Where to store the value
+  /// @param inputs The names of the options of parser and of the derived values it is computed from,
+  /// which must have been added already, so the dependencies cannot form a cycle.  A derived value
+  /// hides an option of the same name.
+  /// @param compute A callable returning the value, which reads its inputs from their destinations
+  template<typename T, typename F>
+  void add_derived( OptionParser& parser, const std::string_view& name, T* dst_ptr,
+                    std::initializer_list<std::string_view> inputs, F&& compute )
+  {
+    parser.extension<DerivedGraph>().add( name, dst_ptr, inputs, std::forward<F>( compute ));
+  }
+
+  /// @Function: set_derive_threads
+  /// Compute the derived values that do not depend on each other on up to num_threads threads, for
+  /// when they are expensive.  They are computed one at a time by default.
+  inline void set_derive_threads( OptionParser& parser, unsigned num_threads )
+  {
+    parser.extension<DerivedGraph>().set_threads( num_threads );
+  }
+
+  /// @Function: update_derived
+  /// Bring the derived values up to date with the options, which parse does by itself
+  /// @returns The number of values computed
+  inline std::size_t update_derived( OptionParser& parser )
+  {
+    DerivedGraph* graph = parser.find_extension<DerivedGraph>();
+    return graph ? graph->update() : 0;
+  }
+PARSE_OPTIONS_NAMESPACE_END
+
+#endif //PARSE_OPTIONS_DERIVED_HPP
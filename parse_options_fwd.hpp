@@ -0,0 +1,88 @@
+/* ------------------------------------------------------------------------------
+MIT License
+
+Copyright (c) 2024 Hugo M. Ayala
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------------ */
+
+#ifndef PARSE_OPTIONS_FWD_HPP
+#define PARSE_OPTIONS_FWD_HPP
+
+// Declarations of the types of parse_options.hpp, for headers that only pass them around, such as
+// a header shared by many translation units that declares
+//
+//   void add_options( parse_options::OptionParser& parser, Settings& settings );
+//
+// It includes nothing, so it costs nothing to include; the translation units that add options or
+// parse include parse_options.hpp.
+
+// PARSE_OPTIONS_SHARED_CONVERTERS and PARSE_OPTIONS_NO_DESCRIPTIONS change what the types hold and how
+// they behave, so everything is declared in an inline namespace named after them.  Translation units
+// built with different settings, such as a program and a parse_options_lib built without its flags,
+// then fail to link instead of silently breaking the one definition rule.
+
+#if defined( PARSE_OPTIONS_SHARED_CONVERTERS ) and defined( PARSE_OPTIONS_NO_DESCRIPTIONS )
+#define PARSE_OPTIONS_ABI shared_converters_no_descriptions
+#elif defined( PARSE_OPTIONS_SHARED_CONVERTERS )
+#define PARSE_OPTIONS_ABI shared_converters_descriptions
+#elif defined( PARSE_OPTIONS_NO_DESCRIPTIONS )
+#define PARSE_OPTIONS_ABI stream_converters_no_descriptions
+#else
+#define PARSE_OPTIONS_ABI stream_converters_descriptions
+#endif
+
+#define PARSE_OPTIONS_NAMESPACE_BEGIN namespace parse_options { inline namespace PARSE_OPTIONS_ABI {
+#define PARSE_OPTIONS_NAMESPACE_END } }
+
+PARSE_OPTIONS_NAMESPACE_BEGIN
+  class OptionRecord;
+  template<class T> class ValueOption;
+  template<class T, class Enable = void> struct value_converter;
+  class SwitchOption;
+  class ArgumentFile;
+  class ArgumentFileOption;
+
+  struct ParseLimits;
+  class ParseLimitError;
+  struct CachedParse;
+  class ParseCache;
+  class ProcessParseCache;
+  class SchemaImage;
+  class ArgumentVector;
+
+  struct PathCheck;
+  struct PathError;
+  class PrefetchedFile;
+  class GlobExpander;
+
+  enum class CompletionShell;
+  class CompletionIndex;
+  class CompletionCache;
+  class CompletionServer;
+  class CompletionClient;
+
+  struct BorrowedStrings;
+  class ParserExtension;
+  class OptionParser;
+  class ProcessCommandLine;
+  template<class T> class RegisteredOption;
+PARSE_OPTIONS_NAMESPACE_END
+
+#endif //PARSE_OPTIONS_FWD_HPP
@@ -0,0 +1,361 @@
+/* ------------------------------------------------------------------------------
+MIT License
+
+Copyright (c) 2024 Hugo M. Ayala
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------------ */
+
+#ifndef PARSE_OPTIONS_GLOB_HPP
+#define PARSE_OPTIONS_GLOB_HPP
+
+// GlobExpander and expand_globs(), which expands the wildcards of arguments that reached the program
+// unexpanded.
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include "parse_options.hpp"
+
+#if defined( PARSE_OPTIONS_HAS_POSIX )
+#include <dirent.h>
+#include <fnmatch.h>
+#endif
+
+PARSE_OPTIONS_NAMESPACE_BEGIN
+#if defined( PARSE_OPTIONS_HAS_POSIX )
+  /// @Class: GlobExpander
+  /// @Description: Expands shell style wildcard patterns (*, ? and [...]) against the file system, for
+  /// arguments that reached the program unexpanded.  Patterns are expanded on a pool of threads that
+  /// share one cache of directory listings, so overlapping patterns read each directory once.  The
+  /// matches of a pattern are sorted, and as in a shell a leading '.' has to be matched explicitly.
+  class GlobExpander
+  {
+    public:
+      /// @param num_threads The size of the pool of threads, all hardware threads by default
+      explicit GlobExpander( unsigned num_threads = 0 ) :
+        num_threads_( num_threads ? num_threads : std::max( 1u, std::thread::hardware_concurrency())) {}
+
+      /// @returns Whether the argument holds any wildcard
+      static bool is_pattern( const std::string_view& arg )
+      {
+        return arg.find_first_of( "*?[" ) != std::string_view::npos;
+      }
+
+      /// @Method: expand
+      /// @param patterns The patterns to expand, which must outlive the call
+      /// @returns The sorted matches of each pattern, in the order of the patterns
+      std::vector<std::vector<std::string>> expand( const std::vector<std::string_view>& patterns )
+      {
+        std::vector<std::vector<std::string>> matches( patterns.size());
+        std::atomic<std::size_t> next{0};
+
+        auto work = [&]() {
+          for( std::size_t ii = next++; ii < patterns.size(); ii = next++ )
+            {
+              expand_one( patterns[ii], matches[ii] );
+            }
+        };
+
+        std::vector<std::thread> pool;
+
+        for( unsigned ii = 1; ii < num_threads_ and ii < patterns.size(); ii += 1 )
+          {
+            pool.emplace_back( work );
+          }
+
+        work();
+
+        for( auto& one : pool )
+          {
+            one.join();
+          }
+
+        return matches;
+      }
+
+      /// @returns The number of directories read, each of them once whatever the number of patterns
+      std::size_t directories_read() const
+      {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        return listings_.size();
+      }
+
+    private:
+      struct Listing
+      {
+        std::once_flag once;
+        std::vector<std::string> names;   // sorted
+      };
+
+      /// @returns The sorted names in a directory, read only by the first thread to ask
+      const std::vector<std::string>& list( const std::string& dir )
+      {
+        std::shared_ptr<Listing> listing;
+
+        {
+          std::lock_guard<std::mutex> lock( mutex_ );
+          std::shared_ptr<Listing>& slot = listings_[dir];
+
+          if( not slot )
+            {
+              slot = std::make_shared<Listing>();
+            }
+
+          listing = slot;
+        }
+
+        std::call_once( listing->once, [&]() {
+          if( DIR* handle = opendir( dir.empty() ? "." : dir.c_str()))
+            {
+              while( const dirent* entry = readdir( handle ))
+                {
+                  std::string_view name( entry->d_name );
+
+                  if( name != "." and name != ".." )
+                    {
+                      listing->names.emplace_back( name );
+                    }
+                }
+
+              closedir( handle );
+              std::sort( listing->names.begin(), listing->names.end());
+            }
+        } );
+
+        return listing->names;
+      }
+
+      void expand_one( const std::string_view& pattern, std::vector<std::string>& out )
+      {
+        std::vector<std::string> components;
+        std::string base;
+
+        if( not pattern.empty() and pattern[0] == '/' )
+          {
+            base = "/";
+          }
+
+        for( std::size_t pos = 0; pos < pattern.size(); )
+          {
+            std::size_t end = pattern.find( '/', pos );
+
+            if( end == std::string_view::npos )
+              {
+                end = pattern.size();
+              }
+
+            if( pos < end )
+              {
+                components.emplace_back( pattern.substr( pos, end - pos ));
+              }
+
+            pos = end + 1;
+          }
+
+        walk( base, components, 0, out );
+      }
+
+      void walk( const std::string& base, const std::vector<std::string>& components, std::size_t index,
+                 std::vector<std::string>& out )
+      {
+        if( index == components.size())
+          {
+            out.push_back( base );
+            return;
+          }
+
+        const std::string& component = components[index];
+        bool last = index + 1 == components.size();
+
+        auto join = [&]( const std::string& name ) {
+          if( base.empty())
+            {
+              return name;
+            }
+
+          return base.back() == '/' ? base + name : base + "/" + name;
+        };
+
+        if( not is_pattern( component ))
+          {
+            std::string path = join( component );
+            struct stat st;
+
+            if( ::stat( path.c_str(), &st ) == 0 and (last or S_ISDIR( st.st_mode )))
+              {
+                walk( path, components, index + 1, out );
+              }
+
+            return;
+          }
+
+        for( const auto& name : list( base ))
+          {
+            if( fnmatch( component.c_str(), name.c_str(), FNM_PERIOD ) == 0 )
+              {
+                std::string path = join( name );
+                struct stat st;
+
+                if( last or (::stat( path.c_str(), &st ) == 0 and S_ISDIR( st.st_mode )))
+                  {
+                    walk( path, components, index + 1, out );
+                  }
+              }
+          }
+      }
+
+      unsigned num_threads_;
+      mutable std::mutex mutex_;
+      std::map<std::string, std::shared_ptr<Listing>> listings_;
+  };
+
+  /// @Class: GlobOptions
+  /// @Description: The options of a parser given to glob_path(), in the order they were added.
+  class GlobOptions final : public ParserExtension
+  {
+    public:
+      explicit GlobOptions( OptionParser& parser ) :
+        ParserExtension( parser ),
+        option_( resource())
+      {}
+
+      void add( const std::string_view& opt_name )
+      {
+        std::size_t option = find_option( opt_name );
+        auto at = std::lower_bound( option_.begin(), option_.end(), option );
+
+        if( at == option_.end() or *at != option )
+          {
+            option_.insert( at, option );
+          }
+      }
+
+      std::size_t expand( unsigned num_threads );
+
+    private:
+      std::pmr::vector<std::size_t> option_;   // indices in OptionParser::options()
+  };
+
+  inline std::size_t GlobOptions::expand( unsigned num_threads )
+  {
+    std::vector<std::string_view> patterns;
+    std::vector<std::size_t> options;
+    std::pmr::vector<std::pmr::string> values( parser_.resource());
+    values.reserve( option_.size());
+
+    for( std::size_t option : option_ )
+      {
+        std::pmr::string& value = values.emplace_back();
+        parser_.options()[option]->format( value );
+
+        if( GlobExpander::is_pattern( value ))
+          {
+            patterns.push_back( value );
+            options.push_back( option );
+          }
+      }
+
+    std::size_t num_options = patterns.size();
+    std::pmr::vector<std::pmr::string>& args = non_option_args();
+
+    for( const auto& one : args )
+      {
+        if( GlobExpander::is_pattern( one ))
+          {
+            patterns.push_back( one );
+          }
+      }
+
+    if( patterns.empty())
+      {
+        return 0;
+      }
+
+    GlobExpander expander( num_threads );
+    std::vector<std::vector<std::string>> matches = expander.expand( patterns );
+
+    for( std::size_t ii = 0; ii < num_options; ii += 1 )
+      {
+        if( matches[ii].size() != 1 )
+          {
+            std::string err_str( matches[ii].empty() ? "no path matches" : "more than one path matches" );
+            err_str.append( " the pattern" );
+
+            throw std::invalid_argument( parser_.options()[options[ii]]->error_message( err_str, patterns[ii] ));
+          }
+
+        parser_.options()[options[ii]]->parse( matches[ii][0].c_str());
+        value_parsed( options[ii], matches[ii][0].c_str());
+      }
+
+    if( num_options < patterns.size())
+      {
+        std::pmr::vector<std::pmr::string> expanded( args.get_allocator());
+        expanded.reserve( args.size());
+        std::size_t next = num_options;
+
+        for( auto& one : args )
+          {
+            if( not GlobExpander::is_pattern( one ) or matches[next].empty())
+              {
+                next += GlobExpander::is_pattern( one );
+                expanded.push_back( std::move( one ));
+                continue;
+              }
+
+            for( const auto& match : matches[next] )
+              {
+                expanded.emplace_back( match );
+              }
+
+            next += 1;
+          }
+
+        args = std::move( expanded );
+      }
+
+    return expander.directories_read();
+  }
+
+  /// @Function: glob_path
+  /// Have expand_globs() expand a wildcard pattern given as the value of an option
+  /// @param opt_name The name of an option already added to parser, in full
+  inline void glob_path( OptionParser& parser, const std::string_view& opt_name )
+  {
+    parser.extension<GlobOptions>().add( opt_name );
+  }
+
+  /// @Function: expand_globs
+  /// Expand the wildcards (*, ? and [...]) in the non-option arguments and in the options given to
+  /// glob_path(), for arguments that were quoted or came from somewhere without a shell.  A non-option
+  /// argument is replaced by its sorted matches, and is kept as given when nothing matches, as a shell
+  /// does.  An option holds one path, so its pattern must match exactly one.  See GlobExpander.
+  /// @param num_threads The size of the pool of threads, all hardware threads by default
+  /// @returns The number of directories read
+  inline std::size_t expand_globs( OptionParser& parser, unsigned num_threads = 0 )
+  {
+    return parser.extension<GlobOptions>().expand( num_threads );
+  }
+#endif
+PARSE_OPTIONS_NAMESPACE_END
+
+#endif //PARSE_OPTIONS_GLOB_HPP
@@ -0,0 +1,20 @@
+// The explicit instantiations behind PARSE_OPTIONS_EXTERN_TEMPLATES, built as the parse_options_lib
+// library so that translation units adding options of these types do not instantiate them again.
+
+#if not defined( PARSE_OPTIONS_EXTERN_TEMPLATES )
+#define PARSE_OPTIONS_EXTERN_TEMPLATES 1
+#endif
+
+#include "parse_options.hpp"
+
+PARSE_OPTIONS_NAMESPACE_BEGIN
+  PARSE_OPTIONS_INSTANCES( , int )
+  PARSE_OPTIONS_INSTANCES( , long )
+  PARSE_OPTIONS_INSTANCES( , long long )
+  PARSE_OPTIONS_INSTANCES( , unsigned )
+  PARSE_OPTIONS_INSTANCES( , unsigned long )
+  PARSE_OPTIONS_INSTANCES( , unsigned long long )
+  PARSE_OPTIONS_INSTANCES( , float )
+  PARSE_OPTIONS_INSTANCES( , double )
+  PARSE_OPTIONS_INSTANCES( , std::string )
+PARSE_OPTIONS_NAMESPACE_END
@@ -0,0 +1,509 @@
+/* ------------------------------------------------------------------------------
+MIT License
+
+Copyright (c) 2024 Hugo M. Ayala
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------------ */
+
+#ifndef PARSE_OPTIONS_PATHS_HPP
+#define PARSE_OPTIONS_PATHS_HPP
+
+// PathCheck and validate_paths(), which checks the path arguments in one batch through io_uring or on
+// a pool of threads.
+
+#include <atomic>
+#include <thread>
+
+#if defined( __linux__ ) and __has_include( <linux/io_uring.h> )
+#include <linux/version.h>
+#if KERNEL_VERSION( 5, 6, 0 ) <= LINUX_VERSION_CODE   // the first with IORING_OP_STATX
+#define PARSE_OPTIONS_HAS_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+#include "parse_options.hpp"
+
+PARSE_OPTIONS_NAMESPACE_BEGIN
+#if defined( PARSE_OPTIONS_HAS_POSIX )
+  /// @Struct: PathCheck
+  /// @Description: The checks validate_paths() can apply to a path, to be combined with |
+  struct PathCheck
+  {
+    enum : unsigned
+    {
+      exists = 1,
+      is_file = 2,
+      is_dir = 4,
+      readable = 8
+    };
+  };
+
+  /// @Struct: PathError
+  /// @Description: A path argument that failed one of its checks
+  struct PathError
+  {
+    std::string argument;     // the name of the option, empty for a non-option argument
+    std::size_t index;        // the index of the non-option argument
+    std::string path;
+    std::string message;
+  };
+
+  /// @Struct: PathStatus
+  /// @Description: The outcome of looking up one path: zero or an errno value, and the file type
+  struct PathStatus
+  {
+    int error{0};
+    mode_t mode{0};
+  };
+
+  /// @Function: stat_path
+  inline PathStatus stat_path( const char* path )
+  {
+    struct stat st;
+
+    if( ::stat( path, &st ) != 0 )
+      {
+        return { errno, 0 };
+      }
+
+    return { 0, st.st_mode };
+  }
+
+  /// @Function: run_on_pool
+  /// Call work( ii ) for every ii below count on a pool of threads, the indices being handed out one at a time
+  template<typename F>
+  void run_on_pool( std::size_t count, unsigned num_threads, F work )
+  {
+    std::atomic<std::size_t> next{0};
+
+    auto drain = [&]() {
+      for( std::size_t ii = next++; ii < count; ii = next++ )
+        {
+          work( ii );
+        }
+    };
+
+    std::vector<std::thread> pool;
+
+    for( unsigned ii = 1; ii < num_threads and ii < count; ii += 1 )
+      {
+        pool.emplace_back( drain );
+      }
+
+    drain();
+
+    for( auto& one : pool )
+      {
+        one.join();
+      }
+  }
+
+  /// @Function: stat_paths_threaded
+  /// Look up every path on a pool of threads
+  inline void stat_paths_threaded( const std::vector<const char*>& paths, std::vector<PathStatus>& status,
+                                   unsigned num_threads )
+  {
+    run_on_pool( paths.size(), num_threads, [&]( std::size_t ii ) { status[ii] = stat_path( paths[ii] ); } );
+  }
+
+#if defined( PARSE_OPTIONS_HAS_IO_URING ) and defined( STATX_TYPE )
+  /// @Function: stat_paths_io_uring
+  /// Look up every path with statx requests submitted through an io_uring, so that the kernel can
+  /// work on many of them at once.  The ring is set up through the raw system calls, no library needed.
+  /// Kernels before 5.6 have io_uring but not its statx, so the ring is probed for it first.
+  /// @returns false when io_uring or its statx is not available, or when the ring failed; the paths
+  /// then have to be looked up another way
+  inline bool stat_paths_io_uring( const std::vector<const char*>& paths, std::vector<PathStatus>& status )
+  {
+    const unsigned ring_entries = 256;
+
+    io_uring_params params{};
+    int ring_fd = static_cast<int>( syscall( __NR_io_uring_setup, ring_entries, &params ));
+
+    if( ring_fd < 0 )
+      {
+        return false;
+      }
+
+    std::size_t sq_size = params.sq_off.array + params.sq_entries * sizeof( unsigned );
+    std::size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof( io_uring_cqe );
+
+    if( params.features & IORING_FEAT_SINGLE_MMAP )
+      {
+        sq_size = cq_size = std::max( sq_size, cq_size );
+      }
+
+    std::size_t sqes_size = params.sq_entries * sizeof( io_uring_sqe );
+
+    void* sq_ring = mmap( nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING );
+    void* cq_ring = sq_ring;
+
+    if( sq_ring != MAP_FAILED and not (params.features & IORING_FEAT_SINGLE_MMAP))
+      {
+        cq_ring = mmap( nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING );
+      }
+
+    void* sqes_map = mmap( nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES );
+
+    auto release = [&]() {
+      if( sqes_map != MAP_FAILED ) munmap( sqes_map, sqes_size );
+      if( cq_ring != MAP_FAILED and cq_ring != sq_ring ) munmap( cq_ring, cq_size );
+      if( sq_ring != MAP_FAILED ) munmap( sq_ring, sq_size );
+      close( ring_fd );
+    };
+
+    if( sq_ring == MAP_FAILED or cq_ring == MAP_FAILED or sqes_map == MAP_FAILED )
+      {
+        release();
+        return false;
+      }
+
+    // the headers may be newer than the kernel, which then rejects the probe or does not list statx
+
+    constexpr unsigned probe_ops = 256;
+    alignas( io_uring_probe ) unsigned char probe_buffer[sizeof( io_uring_probe ) + probe_ops * sizeof( io_uring_probe_op )] = {};
+    io_uring_probe* probe = reinterpret_cast<io_uring_probe*>( probe_buffer );
+
+    if( syscall( __NR_io_uring_register, ring_fd, IORING_REGISTER_PROBE, probe, probe_ops ) < 0
+        or probe->last_op < IORING_OP_STATX or not (probe->ops[IORING_OP_STATX].flags & IO_URING_OP_SUPPORTED))
+      {
+        release();
+        return false;
+      }
+
+    auto at = []( void* base, unsigned offset ) {
+      return reinterpret_cast<std::atomic<unsigned>*>( static_cast<char*>( base ) + offset );
+    };
+
+    std::atomic<unsigned>* sq_tail = at( sq_ring, params.sq_off.tail );
+    unsigned sq_mask = *reinterpret_cast<unsigned*>( static_cast<char*>( sq_ring ) + params.sq_off.ring_mask );
+    unsigned* sq_array = reinterpret_cast<unsigned*>( static_cast<char*>( sq_ring ) + params.sq_off.array );
+    std::atomic<unsigned>* cq_head = at( cq_ring, params.cq_off.head );
+    std::atomic<unsigned>* cq_tail = at( cq_ring, params.cq_off.tail );
+    unsigned cq_mask = *reinterpret_cast<unsigned*>( static_cast<char*>( cq_ring ) + params.cq_off.ring_mask );
+    io_uring_cqe* cqes = reinterpret_cast<io_uring_cqe*>( static_cast<char*>( cq_ring ) + params.cq_off.cqes );
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>( sqes_map );
+
+    std::vector<struct statx> results( std::min<std::size_t>( paths.size(), params.sq_entries ));
+    std::vector<std::size_t> slot_path( results.size());   // which path each statx buffer belongs to
+    std::vector<unsigned> free_slots;
+
+    for( unsigned ii = 0; ii < results.size(); ii += 1 )
+      {
+        free_slots.push_back( ii );
+      }
+
+    std::size_t next = 0;
+    std::size_t in_flight = 0;
+    unsigned unsubmitted = 0;   // entries in the submission queue the kernel has not consumed yet
+    bool failed = false;
+
+    // collect the completions, returns how many there were
+
+    auto reap = [&]() {
+      unsigned head = cq_head->load( std::memory_order_relaxed );
+      std::size_t num_reaped = 0;
+
+      while( head != cq_tail->load( std::memory_order_acquire ))
+        {
+          const io_uring_cqe& cqe = cqes[head & cq_mask];
+          unsigned slot = static_cast<unsigned>( cqe.user_data );
+          std::size_t path = slot_path[slot];
+
+          if( cqe.res < 0 )
+            {
+              status[path] = { -cqe.res, 0 };
+            }
+          else
+            {
+              status[path] = { 0, static_cast<mode_t>( results[slot].stx_mode ) };
+            }
+
+          free_slots.push_back( slot );
+          in_flight -= 1;
+          num_reaped += 1;
+          head += 1;
+        }
+
+      cq_head->store( head, std::memory_order_release );
+      return num_reaped;
+    };
+
+    while( (next < paths.size() or in_flight) and not failed )
+      {
+        unsigned to_submit = 0;
+        unsigned tail = sq_tail->load( std::memory_order_relaxed );
+
+        while( next < paths.size() and not free_slots.empty())
+          {
+            unsigned slot = free_slots.back();
+            free_slots.pop_back();
+            slot_path[slot] = next;
+
+            unsigned index = (tail + to_submit) & sq_mask;
+            io_uring_sqe& sqe = sqes[index];
+
+            std::memset( &sqe, 0, sizeof( sqe ));
+            sqe.opcode = IORING_OP_STATX;
+            sqe.fd = AT_FDCWD;
+            sqe.addr = reinterpret_cast<std::uint64_t>( paths[next] );
+            sqe.len = STATX_TYPE | STATX_MODE;
+            sqe.off = reinterpret_cast<std::uint64_t>( &results[slot] );
+            sqe.user_data = slot;
+
+            sq_array[index] = index;
+            to_submit += 1;
+            next += 1;
+          }
+
+        sq_tail->store( tail + to_submit, std::memory_order_release );
+        in_flight += to_submit;
+        unsubmitted += to_submit;
+
+        int entered = static_cast<int>( syscall( __NR_io_uring_enter, ring_fd, unsubmitted, 1, IORING_ENTER_GETEVENTS,
+                                                 nullptr, 0 ));
+
+        if( 0 <= entered )
+          {
+            unsubmitted -= entered;
+          }
+        else if( errno != EINTR )
+          {
+            failed = true;
+            break;
+          }
+
+        reap();
+      }
+
+    // the kernel still writes into results for the requests it took, so they have to complete before
+    // results is freed; the ones it never took stay in the submission queue and die with the ring
+
+    std::size_t taken = in_flight - unsubmitted;
+
+    while( failed and 0 < taken )
+      {
+        if( syscall( __NR_io_uring_enter, ring_fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0 ) < 0
+            and errno != EINTR and errno != EAGAIN and errno != EBUSY )
+          {
+            new std::vector<struct statx>( std::move( results ));   // cannot wait for them, leave them their buffers
+            break;
+          }
+
+        taken -= reap();
+      }
+
+    release();
+
+    return not failed;
+  }
+#endif
+
+  /// @Function: stat_paths
+  /// Look up a batch of paths, through io_uring where the kernel offers it and on a pool of threads otherwise
+  inline void stat_paths( const std::vector<const char*>& paths, std::vector<PathStatus>& status, unsigned num_threads )
+  {
+    status.assign( paths.size(), PathStatus());
+
+#if defined( PARSE_OPTIONS_HAS_IO_URING ) and defined( STATX_TYPE )
+    if( stat_paths_io_uring( paths, status ))
+      {
+        return;
+      }
+#endif
+
+    stat_paths_threaded( paths, status, num_threads );
+  }
+
+  /// @Class: PathChecks
+  /// @Description: The paths validate_paths() checks for a parser, kept in the order the options were added.
+  class PathChecks final : public ParserExtension
+  {
+    public:
+      explicit PathChecks( OptionParser& parser ) :
+        ParserExtension( parser ),
+        required_( resource())
+      {}
+
+      void require( const std::string_view& opt_name, unsigned checks )
+      {
+        Required one{ find_option( opt_name ), checks };
+        auto at = std::lower_bound( required_.begin(), required_.end(), one, []( const Required& lhs, const Required& rhs ) {
+          return lhs.option < rhs.option;
+        } );
+
+        if( at != required_.end() and at->option == one.option )
+          {
+            at->checks = checks;
+          }
+        else
+          {
+            required_.insert( at, one );
+          }
+      }
+
+      void require_positional( unsigned checks ) { positional_checks_ = checks; }
+
+      std::vector<PathError> validate( unsigned num_threads ) const;
+
+    private:
+      struct Required
+      {
+        std::size_t option;       // the index of the option in OptionParser::options()
+        unsigned checks;
+      };
+
+      std::pmr::vector<Required> required_;
+      unsigned positional_checks_{0};   // the PathCheck values applied to the non-option arguments
+  };
+
+  inline std::vector<PathError> PathChecks::validate( unsigned num_threads ) const
+  {
+    struct Request
+    {
+      const OptionRecord* option;   // or null for a non-option argument
+      std::size_t index;
+      unsigned checks;
+    };
+
+    std::vector<Request> requests;
+    std::vector<const char*> paths;
+    std::pmr::vector<std::pmr::string> values( parser_.resource());
+    values.reserve( required_.size());
+
+    for( const auto& one : required_ )
+      {
+        const OptionRecord* option = parser_.options()[one.option];
+        std::pmr::string& value = values.emplace_back();
+        option->format( value );
+
+        if( not value.empty())
+          {
+            requests.push_back( { option, 0, one.checks } );
+            paths.push_back( value.c_str());
+          }
+      }
+
+    if( positional_checks_ )
+      {
+        const auto& args = non_option_args();
+
+        for( std::size_t ii = 0; ii < args.size(); ii += 1 )
+          {
+            requests.push_back( { nullptr, ii, positional_checks_ } );
+            paths.push_back( args[ii].c_str());
+          }
+      }
+
+    if( num_threads == 0 )
+      {
+        num_threads = std::max( 1u, std::thread::hardware_concurrency());
+      }
+
+    std::vector<PathStatus> status;
+    stat_paths( paths, status, num_threads );
+
+    std::vector<const char*> messages( requests.size(), nullptr );
+    std::vector<std::size_t> to_read;   // the requests that passed the other checks and must be readable
+
+    for( std::size_t ii = 0; ii < requests.size(); ii += 1 )
+      {
+        unsigned checks = requests[ii].checks;
+        mode_t mode = status[ii].mode;
+
+        if( status[ii].error )
+          {
+            messages[ii] = status[ii].error == ENOENT ? "does not exist" : std::strerror( status[ii].error );
+          }
+        else if( (checks & PathCheck::is_file) and not S_ISREG( mode ))
+          {
+            messages[ii] = "is not a regular file";
+          }
+        else if( (checks & PathCheck::is_dir) and not S_ISDIR( mode ))
+          {
+            messages[ii] = "is not a directory";
+          }
+        else if( checks & PathCheck::readable )
+          {
+            to_read.push_back( ii );
+          }
+      }
+
+    // access() has no io_uring counterpart, so it goes on the pool too rather than one path at a time
+
+    run_on_pool( to_read.size(), num_threads, [&]( std::size_t ii ) {
+      if( access( paths[to_read[ii]], R_OK ) != 0 )
+        {
+          messages[to_read[ii]] = "is not readable";
+        }
+    } );
+
+    std::vector<PathError> errors;
+
+    for( std::size_t ii = 0; ii < requests.size(); ii += 1 )
+      {
+        const char* message = messages[ii];
+
+        if( message )
+          {
+            const OptionRecord* option = requests[ii].option;
+
+            errors.push_back( { option ? std::string( option->name()) : std::string(), requests[ii].index,
+                                paths[ii], message } );
+          }
+      }
+
+    return errors;
+  }
+  /// @Function: require_path
+  /// Have validate_paths() check the path held by an option
+  /// @param opt_name The name of an option already added to parser, in full
+  /// @param checks A combination of PathCheck values
+  inline void require_path( OptionParser& parser, const std::string_view& opt_name, unsigned checks )
+  {
+    parser.extension<PathChecks>().require( opt_name, checks );
+  }
+
+  /// @Function: require_positional_paths
+  /// Have validate_paths() check every non-option argument as a path
+  /// @param checks A combination of PathCheck values
+  inline void require_positional_paths( OptionParser& parser, unsigned checks )
+  {
+    parser.extension<PathChecks>().require_positional( checks );
+  }
+
+  /// @Function: validate_paths
+  /// Check all of the paths named by the options given to require_path() and, with
+  /// require_positional_paths(), by the non-option arguments, in one batch after parsing.  The lookups
+  /// go through io_uring where the kernel offers it and through a pool of threads otherwise, which
+  /// matters when there are many paths on a slow file system.  Options with an empty value are skipped.
+  /// @param num_threads The size of the pool of threads, all hardware threads by default
+  /// @returns One PathError for each path that failed one of its checks, in argument order
+  inline std::vector<PathError> validate_paths( const OptionParser& parser, unsigned num_threads = 0 )
+  {
+    const PathChecks* checks = parser.find_extension<PathChecks>();
+    return checks ? checks->validate( num_threads ) : std::vector<PathError>();
+  }
+#endif
+PARSE_OPTIONS_NAMESPACE_END
+
+#endif //PARSE_OPTIONS_PATHS_HPP
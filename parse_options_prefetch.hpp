@@ -0,0 +1,213 @@
+/* ------------------------------------------------------------------------------
+MIT License
+
+Copyright (c) 2024 Hugo M. Ayala
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------------ */
+
+#ifndef PARSE_OPTIONS_PREFETCH_HPP
+#define PARSE_OPTIONS_PREFETCH_HPP
+
+// PrefetchedFile and prefetch_path(), which open the file named by an option in the
+// background as soon as the option is parsed.
+
+#include <future>
+
+#include "parse_options.hpp"
+
+PARSE_OPTIONS_NAMESPACE_BEGIN
+#if defined( PARSE_OPTIONS_HAS_POSIX )
+  /// @Class: PrefetchedFile
+  /// @Description: A file opened on a background thread, with the kernel asked to start reading it
+  /// ahead, so that the I/O overlaps whatever the program does between parsing its options and reading
+  /// its input.  Tie one to a path option with prefetch_path(); the open starts as soon as
+  /// the option's value is parsed, and fd() waits for it.  The descriptor belongs to the PrefetchedFile,
+  /// which closes it, unless the program takes it with release().
+  class PrefetchedFile
+  {
+    public:
+      PrefetchedFile() = default;
+
+      PrefetchedFile( const PrefetchedFile& ) = delete;
+      PrefetchedFile& operator=( const PrefetchedFile& ) = delete;
+
+      ~PrefetchedFile() { reset(); }
+
+      /// @Method: start
+      /// Open a path in the background, closing the file opened before if any
+      void start( std::string path )
+      {
+        reset();
+        path_ = std::move( path );
+        pending_ = std::async( std::launch::async, open_ahead, path_ );
+      }
+
+      /// @returns The path given to start
+      const std::string& path() const { return path_; }
+
+      /// @returns Whether start was called since the file was last released
+      bool started() const { return pending_.valid() or fd_ != -1 or error_ != 0; }
+
+      /// @Method: fd
+      /// Wait for the open to complete
+      /// @returns The descriptor, or -1 when the file could not be opened or no open was started
+      int fd()
+      {
+        wait();
+        return fd_;
+      }
+
+      /// @returns The errno of the open, or 0
+      int error()
+      {
+        wait();
+        return error_;
+      }
+
+      /// @Method: release
+      /// @returns The descriptor, which the caller now has to close
+      int release()
+      {
+        wait();
+        int fd = fd_;
+        fd_ = -1;
+        error_ = 0;
+        return fd;
+      }
+
+    private:
+      struct Result
+      {
+        int fd;
+        int error;
+      };
+
+      static Result open_ahead( std::string path )
+      {
+        int fd = ::open( path.c_str(), O_RDONLY | O_CLOEXEC );
+
+        if( fd < 0 )
+          {
+            return { -1, errno };
+          }
+
+#if defined( POSIX_FADV_WILLNEED )
+        posix_fadvise( fd, 0, 0, POSIX_FADV_WILLNEED );   // starts the readahead of the whole file
+#elif defined( F_RDADVISE )
+        struct stat st;
+
+        if( fstat( fd, &st ) == 0 )
+          {
+            struct radvisory advice{ 0, static_cast<int>( std::min<off_t>( st.st_size, INT32_MAX )) };
+            fcntl( fd, F_RDADVISE, &advice );
+          }
+#endif
+
+        return { fd, 0 };
+      }
+
+      void wait()
+      {
+        if( pending_.valid())
+          {
+            Result result = pending_.get();
+            fd_ = result.fd;
+            error_ = result.error;
+          }
+      }
+
+      void reset()
+      {
+        wait();
+
+        if( fd_ != -1 )
+          {
+            ::close( fd_ );
+          }
+
+        fd_ = -1;
+        error_ = 0;
+      }
+
+      std::string path_;
+      std::future<Result> pending_;
+      int fd_{-1};
+      int error_{0};
+  };
+
+  /// @Class: PrefetchOptions
+  /// @Description: The options of a parser given to prefetch_path(), with the file each one opens.
+  class PrefetchOptions final : public ParserExtension
+  {
+    public:
+      explicit PrefetchOptions( OptionParser& parser ) :
+        ParserExtension( parser ),
+        file_( resource())
+      {}
+
+      void add( const std::string_view& opt_name, PrefetchedFile* file )
+      {
+        std::size_t option = find_option( opt_name );
+
+        for( auto& one : file_ )
+          {
+            if( one.option == option )
+              {
+                one.file = file;
+                return;
+              }
+          }
+
+        file_.push_back( { option, file } );
+      }
+
+      void after_value( std::size_t option, const char* value ) override
+      {
+        for( auto& one : file_ )
+          {
+            if( one.option == option )
+              {
+                one.file->start( value );
+              }
+          }
+      }
+
+    private:
+      struct Prefetch
+      {
+        std::size_t option;       // the index of the option in OptionParser::options()
+        PrefetchedFile* file;
+      };
+
+      std::pmr::vector<Prefetch> file_;
+  };
+
+  /// @Function: prefetch_path
+  /// Open the file named by an option in the background as soon as its value is parsed
+  /// @param opt_name The name of an option already added to parser, in full
+  /// @param file Where the open file is handed to the program, which must outlive the parser
+  inline void prefetch_path( OptionParser& parser, const std::string_view& opt_name, PrefetchedFile* file )
+  {
+    parser.extension<PrefetchOptions>().add( opt_name, file );
+  }
+#endif
+PARSE_OPTIONS_NAMESPACE_END
+
+#endif //PARSE_OPTIONS_PREFETCH_HPP
@@ -0,0 +1,300 @@
+/* ------------------------------------------------------------------------------
+MIT License
+
+Copyright (c) 2024 Hugo M. Ayala
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------------ */
+
+#ifndef PARSE_OPTIONS_SCHEMA_HPP
+#define PARSE_OPTIONS_SCHEMA_HPP
+
+// SchemaImage, which pre-forked workers map to share the names and descriptions of their options,
+// and the functions that build one from a parser and attach a parser to one.
+
+#include "parse_options.hpp"
+
+PARSE_OPTIONS_NAMESPACE_BEGIN
+  /// @Class: SchemaImage
+  /// @Description: A read-only, position independent image of the names, descriptions and types of the
+  /// options of a parser, with the options sorted by name.  schema_image() builds it once,
+  /// typically before forking; it can be written to a file or a memfd and mapped by every worker, whose
+  /// parsers attach() to it so that their records point into the shared image instead of copying the
+  /// strings.  The image only holds offsets, so it can be mapped at any address.
+  class SchemaImage
+  {
+    public:
+      struct Header
+      {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t num_options;
+        std::uint64_t size;           // of the whole image
+      };
+
+      struct Entry
+      {
+        std::uint64_t type_hash;
+        std::uint32_t name_offset;    // from the start of the image
+        std::uint32_t name_size;
+        std::uint32_t description_offset;
+        std::uint32_t description_size;
+      };
+
+      static constexpr char magic[8] = { 'P', 'O', 'S', 'C', 'H', 'E', 'M', 'A' };
+      static constexpr std::uint32_t version = 1;
+
+      /// @Method: SchemaImage
+      /// View an image that is already in memory, which must outlive this object
+      /// @throws std::invalid_argument when the bytes are not a schema image
+      SchemaImage( const void* data, std::size_t size ) :
+        data_( static_cast<const char*>( data )),
+        size_( size )
+      {
+        validate();
+      }
+
+      SchemaImage( SchemaImage&& other ) noexcept :
+        data_( other.data_ ),
+        size_( other.size_ ),
+        mapped_( other.mapped_ )
+      {
+        other.mapped_ = false;
+      }
+
+      SchemaImage( const SchemaImage& ) = delete;
+      SchemaImage& operator=( const SchemaImage& ) = delete;
+      SchemaImage& operator=( SchemaImage&& ) = delete;
+
+      ~SchemaImage()
+      {
+#if defined( PARSE_OPTIONS_HAS_MMAP )
+        if( mapped_ )
+          {
+            munmap( const_cast<char*>( data_ ), size_ );
+          }
+#endif
+      }
+
+#if defined( PARSE_OPTIONS_HAS_MMAP )
+      /// @Method: map
+      /// Map the image held by a file or a memfd read-only and shared
+      /// @throws std::invalid_argument when the file cannot be mapped or is not a schema image
+      static SchemaImage map( int fd )
+      {
+        struct stat st;
+
+        if( fstat( fd, &st ) != 0 or st.st_size < static_cast<off_t>( sizeof( Header )))
+          {
+            throw std::invalid_argument( "ERROR: cannot map schema image: bad file\n" );
+          }
+
+        void* data = mmap( nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+
+        if( data == MAP_FAILED )
+          {
+            throw std::invalid_argument( "ERROR: cannot map schema image: mmap failed\n" );
+          }
+
+        try
+          {
+            SchemaImage image( data, st.st_size );
+            image.mapped_ = true;
+            return image;
+          }
+        catch( ... )
+          {
+            munmap( data, st.st_size );
+            throw;
+          }
+      }
+#endif
+
+      const void* data() const { return data_; }
+
+      std::size_t size() const { return size_; }
+
+      std::size_t num_options() const { return header().num_options; }
+
+      /// @returns The entry for the option with this exact name, or null
+      const Entry* find( const std::string_view& name ) const
+      {
+        const Entry* first = entries();
+        const Entry* last = first + num_options();
+
+        while( first < last )   // binary search on the sorted names
+          {
+            const Entry* mid = first + (last - first) / 2;
+            int cmp = entry_name( *mid ).compare( name );
+
+            if( cmp == 0 )
+              {
+                return mid;
+              }
+
+            if( cmp < 0 )
+              {
+                first = mid + 1;
+              }
+            else
+              {
+                last = mid;
+              }
+          }
+
+        return nullptr;
+      }
+
+      std::string_view entry_name( const Entry& entry ) const
+      {
+        return std::string_view( data_ + entry.name_offset, entry.name_size );
+      }
+
+      std::string_view entry_description( const Entry& entry ) const
+      {
+        return std::string_view( data_ + entry.description_offset, entry.description_size );
+      }
+
+    private:
+      const Header& header() const { return *reinterpret_cast<const Header*>( data_ ); }
+
+      const Entry* entries() const { return reinterpret_cast<const Entry*>( data_ + sizeof( Header )); }
+
+      void validate() const
+      {
+        if( size_ < sizeof( Header ) or std::memcmp( header().magic, magic, sizeof( magic )) != 0
+            or header().version != version or header().size != size_
+            or (size_ - sizeof( Header )) / sizeof( Entry ) < header().num_options )
+          {
+            throw std::invalid_argument( "ERROR: not a schema image\n" );
+          }
+
+        for( std::size_t ii = 0; ii < num_options(); ii += 1 )
+          {
+            const Entry& one = entries()[ii];
+
+            if( size_ < std::uint64_t( one.name_offset ) + one.name_size
+                or size_ < std::uint64_t( one.description_offset ) + one.description_size )
+              {
+                throw std::invalid_argument( "ERROR: corrupt schema image\n" );
+              }
+          }
+      }
+
+      const char* data_;
+      std::size_t size_;
+      bool mapped_{false};
+  };
+
+  /// @Class: SchemaAttachment
+  /// @Description: The SchemaImage a parser was attached to, which the options added afterwards
+  /// borrow their names and descriptions from.
+  class SchemaAttachment final : public ParserExtension
+  {
+    public:
+      explicit SchemaAttachment( OptionParser& parser ) : ParserExtension( parser ) {}
+
+      void attach( const SchemaImage& image ) { image_ = &image; }
+
+      bool find_strings( const std::string_view& name, BorrowedStrings& strings ) const override
+      {
+        const SchemaImage::Entry* entry = image_ ? image_->find( name ) : nullptr;
+
+        if( entry )
+          {
+            strings = { entry->type_hash, image_->entry_name( *entry ), image_->entry_description( *entry ) };
+          }
+
+        return entry != nullptr;
+      }
+
+    private:
+      const SchemaImage* image_{nullptr};
+  };
+
+  /// @Function: schema_image
+  /// @returns The SchemaImage of the options of parser, as bytes to write to a file or a memfd
+  inline std::string schema_image( const OptionParser& parser )
+  {
+    std::pmr::vector<const OptionRecord*> sorted( parser.options().begin(), parser.options().end(),
+                                                  parser.resource());
+
+    std::sort( sorted.begin(), sorted.end(), []( const OptionRecord* lhs, const OptionRecord* rhs ) {
+      return lhs->name() < rhs->name();
+    } );
+
+    sorted.erase( std::unique( sorted.begin(), sorted.end(), []( const OptionRecord* lhs, const OptionRecord* rhs ) {
+      return lhs->name() == rhs->name();
+    } ), sorted.end());
+
+    std::size_t size = sizeof( SchemaImage::Header ) + sorted.size() * sizeof( SchemaImage::Entry );
+
+    for( const auto* one : sorted )
+      {
+        size += one->name().size() + one->description().size();
+      }
+
+    if( std::numeric_limits<std::uint32_t>::max() < size )
+      {
+        throw std::invalid_argument( "ERROR: schema image too large\n" );
+      }
+
+    std::string image( size, '\0' );
+
+    SchemaImage::Header header{};
+    std::memcpy( header.magic, SchemaImage::magic, sizeof( header.magic ));
+    header.version = SchemaImage::version;
+    header.num_options = static_cast<std::uint32_t>( sorted.size());
+    header.size = size;
+    std::memcpy( image.data(), &header, sizeof( header ));
+
+    std::size_t entry_at = sizeof( SchemaImage::Header );
+    std::size_t string_at = entry_at + sorted.size() * sizeof( SchemaImage::Entry );
+
+    for( const auto* one : sorted )
+      {
+        SchemaImage::Entry entry{};
+        entry.type_hash = record_type_hash( *one );
+        entry.name_offset = static_cast<std::uint32_t>( string_at );
+        entry.name_size = static_cast<std::uint32_t>( one->name().size());
+        entry.description_offset = static_cast<std::uint32_t>( string_at + one->name().size());
+        entry.description_size = static_cast<std::uint32_t>( one->description().size());
+
+        std::memcpy( image.data() + entry_at, &entry, sizeof( entry ));
+        image.replace( string_at, one->name().size(), one->name());
+        image.replace( entry.description_offset, one->description().size(), one->description());
+
+        entry_at += sizeof( entry );
+        string_at += one->name().size() + one->description().size();
+      }
+
+    return image;
+  }
+
+  /// @Function: attach
+  /// Point the options added to parser from now on at the names and descriptions in image, which must
+  /// outlive the parser, instead of copying them
+  /// @throws std::invalid_argument from add() when an option of image has a different type
+  inline void attach( OptionParser& parser, const SchemaImage& image )
+  {
+    parser.extension<SchemaAttachment>().attach( image );
+  }
+PARSE_OPTIONS_NAMESPACE_END
+
+#endif //PARSE_OPTIONS_SCHEMA_HPP
@@ -1,15 +1,104 @@
 //
 // Created by Hugo Ayala on 4/16/24.
 //
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <optional>
 #include <string>
 #include <vector>
+#include <memory_resource>
 
 #include "parse_options.hpp"
+#include "parse_options_cache.hpp"
+#include "parse_options_completion.hpp"
+#include "parse_options_derived.hpp"
+#include "parse_options_glob.hpp"
+#include "parse_options_paths.hpp"
+#include "parse_options_prefetch.hpp"
+#include "parse_options_schema.hpp"
 
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 
 #include <doctest/doctest.h>
 
+// Count the allocations made from the global heap while a test has turned counting on
+
+static bool count_heap_allocations = false;
+static int num_heap_allocations = 0;
+
+// Every form of new and delete is replaced, so that all of them go through the same two functions
+
+static void* counted_allocate( std::size_t size, std::size_t alignment ) noexcept
+{
+  if( count_heap_allocations )
+    {
+      num_heap_allocations += 1;
+    }
+
+  size = size ? size : 1;
+
+  if( alignment <= alignof( std::max_align_t ))
+    {
+      return std::malloc( size );
+    }
+
+  return std::aligned_alloc( alignment, (size + alignment - 1) / alignment * alignment );
+}
+
+// Out of line, or GCC sees free() called on what operator new returned and warns of a mismatch
+
+[[gnu::noinline]] static void counted_release( void* ptr ) noexcept
+{
+  std::free( ptr );
+}
+
+static void* counted_new( std::size_t size, std::size_t alignment )
+{
+  if( void* ptr = counted_allocate( size, alignment ))
+    {
+      return ptr;
+    }
+
+  throw std::bad_alloc();
+}
+
+void* operator new( std::size_t size ) { return counted_new( size, 0 ); }
+void* operator new[]( std::size_t size ) { return counted_new( size, 0 ); }
+void* operator new( std::size_t size, std::align_val_t align ) { return counted_new( size, std::size_t( align )); }
+void* operator new[]( std::size_t size, std::align_val_t align ) { return counted_new( size, std::size_t( align )); }
+
+void* operator new( std::size_t size, const std::nothrow_t& ) noexcept { return counted_allocate( size, 0 ); }
+void* operator new[]( std::size_t size, const std::nothrow_t& ) noexcept { return counted_allocate( size, 0 ); }
+
+void* operator new( std::size_t size, std::align_val_t align, const std::nothrow_t& ) noexcept
+{
+  return counted_allocate( size, std::size_t( align ));
+}
+
+void* operator new[]( std::size_t size, std::align_val_t align, const std::nothrow_t& ) noexcept
+{
+  return counted_allocate( size, std::size_t( align ));
+}
+
+void operator delete( void* ptr ) noexcept { counted_release( ptr ); }
+void operator delete[]( void* ptr ) noexcept { counted_release( ptr ); }
+void operator delete( void* ptr, std::size_t ) noexcept { counted_release( ptr ); }
+void operator delete[]( void* ptr, std::size_t ) noexcept { counted_release( ptr ); }
+void operator delete( void* ptr, std::align_val_t ) noexcept { counted_release( ptr ); }
+void operator delete[]( void* ptr, std::align_val_t ) noexcept { counted_release( ptr ); }
+void operator delete( void* ptr, std::size_t, std::align_val_t ) noexcept { counted_release( ptr ); }
+void operator delete[]( void* ptr, std::size_t, std::align_val_t ) noexcept { counted_release( ptr ); }
+void operator delete( void* ptr, const std::nothrow_t& ) noexcept { counted_release( ptr ); }
+void operator delete[]( void* ptr, const std::nothrow_t& ) noexcept { counted_release( ptr ); }
+void operator delete( void* ptr, std::align_val_t, const std::nothrow_t& ) noexcept { counted_release( ptr ); }
+void operator delete[]( void* ptr, std::align_val_t, const std::nothrow_t& ) noexcept { counted_release( ptr ); }
+
 class cli_helper
 {
   public:
@@ -253,6 +342,25 @@ TEST_CASE( "Check Errors" )
           CHECK_THROWS_WITH( parser.parse( 2, argv ), doctest::Contains( "missing argument" ));
         }
     }
+  SUBCASE( "error text" )
+    {
+      parser.add( "integer", "An option that takes one and only one integer", &testOptions.int_value );
+
+      const char* argv[3];
+      argv[0] = "program";
+      argv[1] = "--integer";
+      argv[2] = "1 2 3";
+
+      SUBCASE( "with value" )
+        {
+          CHECK_THROWS_WITH( parser.parse( 3, argv ),
+                             "Error: too many arguments\n  parameter: integer  value: \"1 2 3\"\n" );
+        }
+      SUBCASE( "without value" )
+        {
+          CHECK_THROWS_WITH( parser.parse( 2, argv ), "Error: missing argument\n  parameter: integer" );
+        }
+    }
   SUBCASE( "ignore option value" )
     {
       parser.add<int>( "integer", "An option that consumes and argument but is ignored", nullptr );
@@ -279,10 +387,1825 @@ TEST_CASE( "Check Usage" )
   parser.add( "twenty_letters_long", "This is the third option", &testOption.three );
 
   std::string usage = parser.usage();
-  CHECK( usage ==       "Tool description\n\n"
+
+  if constexpr (parse_options::keep_descriptions)
+    {
+      CHECK( usage ==   "Tool description\n\n"
                         "OPTIONS:\n\n"
                         "  --one             This is the first option\n"
                         "  --two             This is the second option\n"
                         "  --twenty_letters_long\n"
                         "                    This is the third option\n" );
-}
\ No newline at end of file
+    }
+  else
+    {
+      CHECK( usage == "OPTIONS:\n\n  --one\n  --two\n  --twenty_letters_long\n" );
+    }
+}
+
+TEST_CASE( "Memory Resource" )
+{
+  struct
+  {
+    bool verbose{false};
+    int integer{0};
+  } testOption;
+
+  cli_helper ch( "program --verbose a_positional_argument_longer_than_any_small_string --integer 42 another_one" );
+
+  // Make sure the stream machinery has been initialized before we start counting
+
+  {
+    int warm_up = 0;
+    parse_options::ValueOption<int> option( "warm_up", "", &warm_up );
+    option.parse( "1" );
+  }
+
+  alignas( std::max_align_t ) std::byte buffer[4096];
+  std::pmr::monotonic_buffer_resource pool( buffer, sizeof( buffer ), std::pmr::null_memory_resource());
+
+  num_heap_allocations = 0;
+  count_heap_allocations = true;
+
+  {
+    parse_options::OptionParser parser( "An option parser that uses a memory resource", &pool );
+
+    parser.add( "verbose", "A boolean option with a description that does not fit in a small string",
+                &testOption.verbose );
+    parser.add( "integer", "An integer option with a description that does not fit in a small string",
+                &testOption.integer );
+
+    parser.parse( ch.argc(), ch.argv());
+
+    CHECK( parser.resource() == &pool );
+    CHECK( parser.pmr_non_option_args().size() == 2 );
+    CHECK( parser.pmr_non_option_args().at( 0 ) == "a_positional_argument_longer_than_any_small_string" );
+  }
+
+  count_heap_allocations = false;
+
+  CHECK( num_heap_allocations == 0 );
+  CHECK( testOption.verbose == true );
+  CHECK( testOption.integer == 42 );
+}
+
+TEST_CASE( "Non Option Arguments" )
+{
+  cli_helper ch( "program first --flag second" );
+
+  bool flag = false;
+  parse_options::OptionParser parser( "Returns the non-option arguments as std::strings" );
+  parser.add( "flag", "A boolean option", &flag );
+  parser.parse( ch.argc(), ch.argv());
+
+  std::vector<std::string> args = parser.non_option_args();
+
+  CHECK( args == std::vector<std::string>( { "first", "second" } ));
+  CHECK( parser.pmr_non_option_args().size() == 2 );
+
+  args.clear();   // a copy, which leaves the parser alone
+
+  CHECK( parser.non_option_args() == std::vector<std::string>( { "first", "second" } ));
+
+  cli_helper more( "program third" );
+  parser.parse( more.argc(), more.argv());
+
+  CHECK( parser.non_option_args() == std::vector<std::string>( { "first", "second", "third" } ));
+}
+
+TEST_CASE( "Parse Limits" )
+{
+  struct
+  {
+    int integer{0};
+  } testOption;
+
+  parse_options::OptionParser parser( "Checks the memory accounting and the limits" );
+
+  size_t empty_schema = parser.schema_bytes();
+
+  parser.add( "integer", "An integer option with a description that does not fit in a small string",
+              &testOption.integer );
+
+  CHECK( empty_schema < parser.schema_bytes());
+
+  cli_helper ch( "program --integer 7 a_positional_argument_longer_than_any_small_string another_long_positional_argument" );
+
+  SUBCASE( "accounting" )
+    {
+      size_t schema = parser.schema_bytes();
+
+      parser.parse( ch.argc(), ch.argv());
+
+      CHECK( testOption.integer == 7 );
+      CHECK( parser.schema_bytes() == schema );
+      CHECK( std::strlen( "a_positional_argument_longer_than_any_small_string" ) < parser.last_parse_bytes());
+    }
+  SUBCASE( "memory budget" )
+    {
+      parse_options::ParseLimits limits;
+      limits.max_bytes = 64;
+      parser.set_limits( limits );
+
+      try
+        {
+          parser.parse( ch.argc(), ch.argv());
+          FAIL( "the memory budget was not enforced" );
+        }
+      catch( const parse_options::ParseLimitError& e1 )
+        {
+          CHECK( e1.limit() == parse_options::ParseLimitError::Limit::memory );
+          CHECK( e1.budget() == 64 );
+          CHECK( 64 < e1.used());
+          CHECK( parser.last_parse_bytes() <= 64 );
+        }
+
+      // The budget applies per parse and an unlimited parse still succeeds afterwards
+
+      parser.set_limits( parse_options::ParseLimits());
+      CHECK_NOTHROW( parser.parse( ch.argc(), ch.argv()));
+    }
+  SUBCASE( "memory budget of string values" )
+    {
+      // a std::string destination allocates on its own, so its value counts against the budget
+
+      std::string name;
+      parser.add( "name", "A string option", &name );
+
+      std::string long_value( 100000, 'x' );
+      const char* argv[] = { "program", "--name", long_value.c_str() };
+
+      parse_options::ParseLimits limits;
+      limits.max_bytes = 1024;
+      parser.set_limits( limits );
+
+      CHECK_THROWS_AS( parser.parse( 3, argv ), parse_options::ParseLimitError );
+      CHECK( name.empty());
+
+      argv[2] = "short";
+      CHECK_NOTHROW( parser.parse( 3, argv ));
+      CHECK( name == "short" );
+    }
+  SUBCASE( "token budget" )
+    {
+      parse_options::ParseLimits limits;
+      limits.max_tokens = 3;
+      parser.set_limits( limits );
+
+      CHECK_THROWS_AS( parser.parse( ch.argc(), ch.argv()), parse_options::ParseLimitError );
+      CHECK_THROWS_WITH( parser.parse( ch.argc(), ch.argv()), doctest::Contains( "token budget exceeded" ));
+      CHECK( testOption.integer == 0 );
+    }
+  SUBCASE( "time budget" )
+    {
+      std::vector<const char*> argv( 200000, "positional" );
+
+      parse_options::ParseLimits limits;
+      limits.max_time = std::chrono::microseconds( 1 );
+      parser.set_limits( limits );
+
+      CHECK_THROWS_WITH( parser.parse( argv.size(), argv.data()), doctest::Contains( "time budget exceeded" ));
+    }
+}
+
+TEST_CASE( "Pass Through" )
+{
+  struct
+  {
+    bool verbose{false};
+    int seconds{0};
+  } testOption;
+
+  parse_options::OptionParser parser( "A launcher that runs another command" );
+
+  parser.add( "verbose", "Print what is being run", &testOption.verbose );
+  parser.add( "seconds", "How long to let the command run", &testOption.seconds );
+
+  SUBCASE( "stop at the first positional" )
+    {
+      cli_helper ch( "launcher --seconds 5 child --verbose" );
+      int tail = parser.parse_pass_through( ch.argc(), ch.argv());
+
+      CHECK( tail == 3 );
+      CHECK( ch.argv()[tail] == std::string_view( "child" ));
+      CHECK( testOption.seconds == 5 );
+      CHECK( testOption.verbose == false );
+      CHECK( parser.non_option_args().empty());
+    }
+  SUBCASE( "stop after double dash" )
+    {
+      cli_helper ch( "launcher --verbose -- --child_option value" );
+      int tail = parser.parse_pass_through( ch.argc(), ch.argv());
+
+      CHECK( tail == 3 );
+      CHECK( ch.argv()[tail] == std::string_view( "--child_option" ));
+      CHECK( testOption.verbose == true );
+    }
+  SUBCASE( "stop at an empty argument" )
+    {
+      const char* argv[] = { "launcher", "--verbose", "", "child", nullptr };
+      int tail = parser.parse_pass_through( 4, argv );
+
+      CHECK( tail == 2 );
+      CHECK( argv[tail] == std::string_view( "" ));
+      CHECK( testOption.verbose == true );
+    }
+  SUBCASE( "no tail" )
+    {
+      cli_helper ch( "launcher --verbose" );
+
+      CHECK( parser.parse_pass_through( ch.argc(), ch.argv()) == ch.argc());
+    }
+  SUBCASE( "unknown options before the tail are still errors" )
+    {
+      cli_helper ch( "launcher --unknown child" );
+
+      CHECK_THROWS_AS( parser.parse_pass_through( ch.argc(), ch.argv()), std::invalid_argument );
+    }
+}
+
+TEST_CASE( "Canonical Arguments" )
+{
+  struct
+  {
+    bool verbose{false};
+    bool quiet{false};
+    int integer{0};
+    std::string name{"default"};
+  } testOption;
+
+  parse_options::OptionParser parser( "Regenerates a command line" );
+
+  parser.add( "verbose", "A boolean option", &testOption.verbose );
+  parser.add( "quiet", "A boolean option that is not given", &testOption.quiet );
+  parser.add( "integer", "An integer option", &testOption.integer );
+  parser.add( "name", "A string option", &testOption.name );
+
+  cli_helper ch( "program positional --name other --int 7" );
+  parser.parse( ch.argc(), ch.argv());
+
+  auto args_string = []( const parse_options::ArgumentVector& args ) {
+    std::string joined;
+
+    for( int ii = 0; ii < args.argc(); ii += 1 )
+      {
+        if( ii ) joined.append( " " );
+        joined.append( args.argv()[ii] );
+      }
+
+    return joined;
+  };
+
+  SUBCASE( "unchanged" )
+    {
+      auto args = parser.arguments();
+
+      CHECK( args_string( args ) == "program --integer 7 --name other positional" );
+      CHECK( args.argv()[args.argc()] == nullptr );
+
+      // the full spelling and its value are reused, the abbreviated --int is formatted
+
+      CHECK( args.argv()[0] == ch.argv()[0] );
+      CHECK( args.argv()[3] == ch.argv()[2] );
+      CHECK( args.argv()[4] == ch.argv()[3] );
+      CHECK( args.argv()[1] != ch.argv()[4] );
+      CHECK( args.argv()[2] == ch.argv()[5] );
+    }
+  SUBCASE( "changed" )
+    {
+      testOption.verbose = true;
+      testOption.integer = 42;
+      testOption.name = "default";
+
+      auto args = parser.arguments( "child" );
+
+      CHECK( args_string( args ) == "child --verbose --integer 42 positional" );
+      CHECK( args.formatted_bytes() == std::strlen( "--verbose" ) + std::strlen( "--integer" ) + std::strlen( "42" ) + 3 );
+    }
+  SUBCASE( "round trip" )
+    {
+      testOption.integer = -3;
+
+      auto args = parser.arguments();
+
+      struct
+      {
+        bool verbose{false};
+        bool quiet{false};
+        int integer{0};
+        std::string name;
+      } copyOption;
+
+      parse_options::OptionParser copy( "Parses the regenerated command line" );
+
+      copy.add( "verbose", "A boolean option", &copyOption.verbose );
+      copy.add( "quiet", "A boolean option that is not given", &copyOption.quiet );
+      copy.add( "integer", "An integer option", &copyOption.integer );
+      copy.add( "name", "A string option", &copyOption.name );
+
+      copy.parse( args.argc(), args.argv());
+
+      CHECK( copyOption.integer == -3 );
+      CHECK( copyOption.name == "other" );
+      REQUIRE( copy.non_option_args().size() == 1 );
+      CHECK( copy.non_option_args().at( 0 ) == "positional" );
+    }
+  SUBCASE( "values that do not read back" )
+    {
+      // parse() rejects an empty value and reads "a b" as two, so neither is written
+
+      for( const char* value : { "", "a b", " a" } )
+        {
+          testOption.name = value;
+          CHECK_THROWS_AS( parser.arguments(), std::invalid_argument );
+        }
+
+      testOption.name = "a_b";
+
+      auto args = parser.arguments();
+
+      std::string name;
+      int integer = 0;
+      parse_options::OptionParser copy( "Parses the regenerated command line" );
+      copy.add( "name", "A string option", &name );
+      copy.add( "integer", "An integer option", &integer );
+      copy.parse( args.argc(), args.argv());
+
+      CHECK( name == "a_b" );
+      CHECK( integer == 7 );
+    }
+  SUBCASE( "defaults are taken at the first parse" )
+    {
+      // the destination of an option may be set between add() and parse()
+
+      int late = 0;
+      parse_options::OptionParser later( "Initializes a destination after adding it" );
+      later.add( "late", "An integer option", &late );
+
+      late = 5;
+
+      cli_helper empty( "program" );
+      later.parse( empty.argc(), empty.argv());
+
+      CHECK( later.arguments().argc() == 1 );
+
+      late = 6;
+
+      CHECK( later.arguments().argc() == 3 );
+    }
+}
+
+TEST_CASE( "Fingerprint" )
+{
+  SUBCASE( "xxhash64" )
+    {
+      const std::string_view text( "Nobody inspects the spammish repetition" );
+
+      CHECK( parse_options::xxhash64( "", 0 ) == 0xEF46DB3751D8E999ULL );
+      CHECK( parse_options::xxhash64( "a", 1 ) == 0xD24EC4F1A98C6E5BULL );
+      CHECK( parse_options::xxhash64( "abc", 3 ) == 0x44BC2CF5AD770999ULL );
+      CHECK( parse_options::xxhash64( text.data(), text.size()) == 0xFBCEA83C8A378BF1ULL );
+      CHECK( parse_options::xxhash64( nullptr, 0 ) == 0xEF46DB3751D8E999ULL );
+    }
+  SUBCASE( "equal floating point values" )
+    {
+      const std::uint64_t nan_bits = 0x7FF8000000000123ULL;
+      double nan_payload;
+      std::memcpy( &nan_payload, &nan_bits, sizeof( nan_payload ));
+
+      CHECK( parse_options::hash_value( -0.0, 0 ) == parse_options::hash_value( 0.0, 0 ));
+      CHECK( parse_options::hash_value( -0.0f, 0 ) == parse_options::hash_value( 0.0f, 0 ));
+      CHECK( parse_options::hash_value( nan_payload, 0 ) == parse_options::hash_value( -std::nan( "" ), 0 ));
+      CHECK( parse_options::hash_value( 1.0, 0 ) != parse_options::hash_value( -1.0, 0 ));
+    }
+
+  struct
+  {
+    bool verbose{false};
+    int integer{0};
+    std::string name{"default"};
+  } testOption;
+
+  parse_options::OptionParser parser( "Fingerprints the configuration" );
+
+  parser.add( "verbose", "A boolean option", &testOption.verbose );
+  parser.add( "integer", "An integer option", &testOption.integer );
+  parser.add( "name", "A string option", &testOption.name );
+
+  auto fingerprint = [&]( const char* cmd_line ) {
+    testOption = {};
+    testOption.name = "default";
+
+    parse_options::OptionParser one( "Fingerprints the configuration" );
+
+    one.add( "verbose", "A boolean option", &testOption.verbose );
+    one.add( "integer", "An integer option", &testOption.integer );
+    one.add( "name", "A string option", &testOption.name );
+
+    cli_helper ch( cmd_line );
+    one.parse( ch.argc(), ch.argv());
+
+    return one.fingerprint();
+  };
+
+  SUBCASE( "spelling and order do not matter" )
+    {
+      CHECK( fingerprint( "program --integer 3 --verbose file" ) == fingerprint( "program -verb file -int 3" ));
+      CHECK( fingerprint( "program --name default" ) == fingerprint( "program" ));
+    }
+  SUBCASE( "values and positionals do" )
+    {
+      CHECK( fingerprint( "program --integer 3" ) != fingerprint( "program --integer 4" ));
+      CHECK( fingerprint( "program --name 3" ) != fingerprint( "program --name 4" ));
+      CHECK( fingerprint( "program --verbose" ) != fingerprint( "program" ));
+      CHECK( fingerprint( "program one two" ) != fingerprint( "program onetwo" ));
+      CHECK( fingerprint( "program one two" ) != fingerprint( "program two one" ));
+    }
+  SUBCASE( "no allocations" )
+    {
+      num_heap_allocations = 0;
+      count_heap_allocations = true;
+
+      std::uint64_t h64 = parser.fingerprint();
+
+      count_heap_allocations = false;
+
+      CHECK( num_heap_allocations == 0 );
+      CHECK( h64 == parser.fingerprint());
+    }
+}
+
+// A type that can be parsed but not copied, which keeps its parser out of the caches
+
+struct MoveOnly
+{
+  std::unique_ptr<int> value;
+};
+
+std::istream& operator>>( std::istream& is, MoveOnly& move_only )
+{
+  int value = 0;
+  is >> value;
+  move_only.value = std::make_unique<int>( value );
+  return is;
+}
+
+template class parse_options::ValueOption<MoveOnly>;
+
+TEST_CASE( "Parse Cache" )
+{
+  struct CacheOptions
+  {
+    bool verbose{false};
+    int integer{0};
+    std::string name;
+  };
+
+  struct CacheParser
+  {
+    explicit CacheParser( CacheOptions& options ) : parser( "Parses through a cache" )
+    {
+      parser.add( "verbose", "A boolean option", &options.verbose );
+      parser.add( "integer", "An integer option", &options.integer );
+      parser.add( "name", "A string option", &options.name );
+    }
+
+    parse_options::OptionParser parser;
+  };
+
+  parse_options::ParseCache cache( 4, 2 );
+  cli_helper ch( "program --int 7 -verbose file --name other" );
+
+  CacheOptions first_options;
+  CacheParser first( first_options );
+
+  first.parser.parse( ch.argc(), ch.argv(), cache );
+
+  CHECK( cache.size() == 1 );
+  CHECK( cache.misses() == 1 );
+
+  SUBCASE( "hit" )
+    {
+      CacheOptions second_options;
+      CacheParser second( second_options );
+
+      second.parser.parse( ch.argc(), ch.argv(), cache );
+
+      CHECK( cache.hits() == 1 );
+      CHECK( second_options.verbose == true );
+      CHECK( second_options.integer == 7 );
+      CHECK( second_options.name == "other" );
+      REQUIRE( second.parser.non_option_args().size() == 1 );
+      CHECK( second.parser.non_option_args().at( 0 ) == "file" );
+      CHECK( second.parser.fingerprint() == first.parser.fingerprint());
+      CHECK( second.parser.arguments().argc() == first.parser.arguments().argc());
+    }
+  SUBCASE( "different schema" )
+    {
+      int integer = 0;
+      bool verbose = false;
+      std::string name;
+
+      parse_options::OptionParser other( "Has one more option" );
+      other.add( "verbose", "A boolean option", &verbose );
+      other.add( "integer", "An integer option", &integer );
+      other.add( "name", "A string option", &name );
+      other.add( "extra", "And one more option", &integer );
+
+      other.parse( ch.argc(), ch.argv(), cache );
+
+      CHECK( cache.hits() == 0 );
+      CHECK( cache.size() == 2 );
+    }
+  SUBCASE( "errors are not cached" )
+    {
+      cli_helper bad( "program --integer seven" );
+
+      CHECK_THROWS_AS( first.parser.parse( bad.argc(), bad.argv(), cache ), std::invalid_argument );
+      CHECK_THROWS_AS( first.parser.parse( bad.argc(), bad.argv(), cache ), std::invalid_argument );
+      CHECK( cache.size() == 1 );
+    }
+  SUBCASE( "least recently used is evicted" )
+    {
+      for( int ii = 0; ii < 20; ii += 1 )
+        {
+          std::string cmd_line( "program --integer " );
+          cmd_line.append( std::to_string( ii ));
+
+          cli_helper one( cmd_line );
+          first.parser.parse( one.argc(), one.argv(), cache );
+        }
+
+      CHECK( cache.size() <= 4 );
+    }
+  SUBCASE( "capacity bounds the shards" )
+    {
+      parse_options::ParseCache small( 4 );
+      parse_options::ParseCache none( 0 );
+      parse_options::ParseCache one_shard( 3, 0 );
+
+      for( int ii = 0; ii < 20; ii += 1 )
+        {
+          std::string cmd_line( "program --integer " );
+          cmd_line.append( std::to_string( ii ));
+
+          cli_helper one( cmd_line );
+          first.parser.parse( one.argc(), one.argv(), small );
+          first.parser.parse( one.argc(), one.argv(), none );
+          first.parser.parse( one.argc(), one.argv(), one_shard );
+        }
+
+      CHECK( small.size() == 4 );
+      CHECK( none.size() == 0 );
+      CHECK( one_shard.size() == 3 );
+      CHECK( first_options.integer == 19 );
+    }
+  SUBCASE( "limits are checked before the lookup" )
+    {
+      parse_options::ParseLimits limits;
+      limits.max_tokens = 2;
+      first.parser.set_limits( limits );
+
+      CHECK_THROWS_AS( first.parser.parse( ch.argc(), ch.argv(), cache ), parse_options::ParseLimitError );
+      CHECK( cache.misses() == 1 );
+      CHECK( cache.hits() == 0 );
+    }
+  SUBCASE( "values that cannot be copied" )
+    {
+      static_assert( not parse_options::ValueOption<MoveOnly>::cacheable );
+
+      MoveOnly move_only;
+      first.parser.add( "move_only", "An option that cannot be copied", &move_only );
+
+      cli_helper more( "program --move_only 5" );
+      first.parser.parse( more.argc(), more.argv(), cache );
+      first.parser.parse( more.argc(), more.argv(), cache );
+
+      REQUIRE( move_only.value );
+      CHECK( *move_only.value == 5 );
+      CHECK( cache.size() == 1 );
+      CHECK( cache.misses() == 1 );
+    }
+}
+
+TEST_CASE( "Schema Image" )
+{
+  struct SchemaOptions
+  {
+    bool verbose{false};
+    int integer{0};
+    std::string name;
+  };
+
+  auto add_options = []( parse_options::OptionParser& parser, SchemaOptions& options ) {
+    parser.add( "verbose", "A boolean option with a description that does not fit in a small string",
+                &options.verbose );
+    parser.add( "integer", "An integer option with a description that does not fit in a small string",
+                &options.integer );
+    parser.add( "name", "A string option with a description that does not fit in a small string",
+                &options.name );
+  };
+
+  SchemaOptions master_options;
+  parse_options::OptionParser master( "Builds the schema image" );
+  add_options( master, master_options );
+
+  std::string bytes = parse_options::schema_image( master );
+
+  SUBCASE( "attached parser" )
+    {
+      parse_options::SchemaImage image( bytes.data(), bytes.size());
+
+      CHECK( image.num_options() == 3 );
+      REQUIRE( image.find( "integer" ) != nullptr );
+      CHECK( image.find( "int" ) == nullptr );
+
+      SchemaOptions worker_options;
+      parse_options::OptionParser worker( "Builds the schema image" );
+      parse_options::attach( worker, image );
+      add_options( worker, worker_options );
+
+      CHECK( worker.schema_bytes() <= master.schema_bytes());
+      CHECK( worker.usage() == master.usage());
+
+      if constexpr (parse_options::keep_descriptions)   // the savings are mostly the descriptions
+        {
+          CHECK( worker.schema_bytes() < master.schema_bytes());
+        }
+
+      cli_helper ch( "program --int 3 --verbose --name other" );
+      worker.parse( ch.argc(), ch.argv());
+
+      CHECK( worker_options.integer == 3 );
+      CHECK( worker_options.verbose == true );
+      CHECK( worker_options.name == "other" );
+    }
+  SUBCASE( "different type" )
+    {
+      parse_options::SchemaImage image( bytes.data(), bytes.size());
+
+      double real = 0.;
+      parse_options::OptionParser worker;
+      parse_options::attach( worker, image );
+
+      CHECK_THROWS_AS( worker.add( "integer", "Now a double", &real ), std::invalid_argument );
+    }
+  SUBCASE( "not an image" )
+    {
+      bytes[0] = 'X';
+
+      CHECK_THROWS_AS( parse_options::SchemaImage( bytes.data(), bytes.size()), std::invalid_argument );
+    }
+#if defined( PARSE_OPTIONS_HAS_MMAP )
+  SUBCASE( "mapped from a file" )
+    {
+      std::FILE* file = std::tmpfile();
+      REQUIRE( file != nullptr );
+      REQUIRE( std::fwrite( bytes.data(), 1, bytes.size(), file ) == bytes.size());
+      std::fflush( file );
+
+      parse_options::SchemaImage image = parse_options::SchemaImage::map( fileno( file ));
+      std::fclose( file );
+
+      SchemaOptions worker_options;
+      parse_options::OptionParser worker;
+      parse_options::attach( worker, image );
+      add_options( worker, worker_options );
+
+      CHECK( image.size() == bytes.size());
+      CHECK( worker.schema_bytes() <= master.schema_bytes());
+
+      if constexpr (parse_options::keep_descriptions)
+        {
+          CHECK( worker.schema_bytes() < master.schema_bytes());
+        }
+
+      cli_helper ch( "program --integer 5" );
+      worker.parse( ch.argc(), ch.argv());
+
+      CHECK( worker_options.integer == 5 );
+    }
+#endif
+}
+
+// Options declared at namespace scope, as a module would next to the code that uses them
+
+static parse_options::RegisteredOption<int> registered_threads( "registered_threads", "Number of worker threads", 4 );
+static parse_options::RegisteredOption<bool> registered_trace( "registered_trace", "Trace the workers" );
+
+TEST_CASE( "Registered Options" )
+{
+  bool found_threads = false;
+
+  for( const auto* one = parse_options::Registration::first(); one; one = one->next())
+    {
+      found_threads = found_threads or one->name() == "registered_threads";
+    }
+
+  CHECK( found_threads );
+  CHECK( *registered_threads == 4 );
+
+  parse_options::OptionParser parser( "Uses the registered options" );
+  parser.add_registered();
+
+  CHECK( parser.usage().find( "--registered_threads" ) != std::string::npos );
+
+  cli_helper ch( "program --registered_th 8 --registered_tr" );
+  parser.parse( ch.argc(), ch.argv());
+
+  CHECK( *registered_threads == 8 );
+  CHECK( *registered_trace == true );
+
+  registered_threads.value() = 4;
+  registered_trace.value() = false;
+
+  SUBCASE( "duplicate names" )
+    {
+      parse_options::RegisteredOption<int> again( "registered_threads", "Declared twice" );
+      parse_options::OptionParser other( "Finds an option registered twice" );
+
+      CHECK_THROWS_AS( other.add_registered(), std::invalid_argument );
+    }
+  SUBCASE( "unlinked in any order" )
+    {
+      auto registered = []( const std::string_view& name ) {
+        for( const auto* one = parse_options::Registration::first(); one; one = one->next())
+          {
+            if( one->name() == name )
+              {
+                return true;
+              }
+          }
+
+        return false;
+      };
+
+      std::optional<parse_options::RegisteredOption<int>> first( std::in_place, "registered_first", "" );
+      std::optional<parse_options::RegisteredOption<int>> middle( std::in_place, "registered_middle", "" );
+      std::optional<parse_options::RegisteredOption<int>> last( std::in_place, "registered_last", "" );
+
+      middle.reset();
+      CHECK( registered( "registered_first" ));
+      CHECK( not registered( "registered_middle" ));
+      CHECK( registered( "registered_last" ));
+
+      last.reset();
+      first.reset();
+      CHECK( not registered( "registered_first" ));
+      CHECK( registered( "registered_threads" ));
+    }
+}
+
+TEST_CASE( "Name Index" )
+{
+  struct
+  {
+    int alpha{0};
+    int alphabet{0};
+    int beta{0};
+  } testOption;
+
+  parse_options::OptionParser parser( "Looks names up in the index" );
+
+  parser.add( "beta", "Added first", &testOption.beta );
+  parser.add( "alphabet", "A name that has another one as prefix", &testOption.alphabet );
+  parser.add( "alpha", "The prefix", &testOption.alpha );
+
+  SUBCASE( "exact and unique prefixes" )
+    {
+      cli_helper ch( "program --alphab 2 --b 3" );
+      parser.parse( ch.argc(), ch.argv());
+
+      CHECK( testOption.alphabet == 2 );
+      CHECK( testOption.beta == 3 );
+      CHECK( testOption.alpha == 0 );
+    }
+  SUBCASE( "an ambiguous prefix goes to the first option added" )
+    {
+      cli_helper ch( "program --alpha 1" );
+      parser.parse( ch.argc(), ch.argv());
+
+      CHECK( testOption.alphabet == 1 );
+      CHECK( testOption.alpha == 0 );
+    }
+  SUBCASE( "options added after a parse" )
+    {
+      int gamma = 0;
+
+      cli_helper ch( "program --beta 1 --gamma 5" );
+      CHECK_THROWS_AS( parser.parse( ch.argc(), ch.argv()), std::invalid_argument );
+
+      parser.add( "gamma", "Added late", &gamma );
+      parser.parse( ch.argc(), ch.argv());
+
+      CHECK( gamma == 5 );
+    }
+  SUBCASE( "unknown" )
+    {
+      cli_helper ch( "program --alphabets 1" );
+      CHECK_THROWS_AS( parser.parse( ch.argc(), ch.argv()), std::invalid_argument );
+    }
+}
+
+#if defined( __linux__ ) or defined( __APPLE__ )
+TEST_CASE( "Process Command Line" )
+{
+  const auto& command_line = parse_options::ProcessCommandLine::get();
+
+  REQUIRE( 1 <= command_line.argc());
+  CHECK( command_line.argv()[command_line.argc()] == nullptr );
+  CHECK( &command_line == &parse_options::ProcessCommandLine::get());
+
+  // The test runner's own options are unknown to this parser and are skipped
+
+  int unused = 0;
+  parse_options::OptionParser parser( "Reads the command line of the process" );
+  parser.add( "parse_options_unused", "An option nobody passes", &unused );
+
+  CHECK_NOTHROW( parser.parse_process_command_line());
+  CHECK( unused == 0 );
+
+  // A parser with the same options, as in another library, reuses the parse
+
+  std::size_t hits = parse_options::ProcessCommandLine::parse_cache().hits();
+  int other_unused = 1;
+  parse_options::OptionParser other( "Reads the command line of the process again" );
+  other.add( "parse_options_unused", "An option nobody passes", &other_unused );
+
+  other.parse_process_command_line();
+
+  CHECK( parse_options::ProcessCommandLine::parse_cache().hits() == hits + 1 );
+  CHECK( other_unused == 1 );
+  CHECK( other.non_option_args() == parser.non_option_args());
+}
+#endif
+
+#if defined( PARSE_OPTIONS_HAS_MMAP )
+TEST_CASE( "Argument File" )
+{
+  char path[] = "/tmp/parse_options_argsXXXXXX";
+  int fd = mkstemp( path );
+  REQUIRE( 0 <= fd );
+
+  const char contents[] = "first\0second file\0\0third";
+  REQUIRE( write( fd, contents, sizeof( contents ) - 1 ) == sizeof( contents ) - 1 );
+  close( fd );
+
+  parse_options::ArgumentFile files;
+  parse_options::OptionParser parser( "Reads arguments from a file" );
+  parser.add( "files_from", "A file of NUL separated paths", &files );
+
+  SUBCASE( "entries are views into the mapping" )
+    {
+      const char* argv[] = { "program", "--files_from", path };
+      parser.parse( 3, argv );
+
+      REQUIRE( files.count() == 3 );
+      CHECK( files.size_bytes() == sizeof( contents ) - 1 );
+
+      std::vector<std::string_view> entries( files.begin(), files.end());
+      CHECK( entries[0] == "first" );
+      CHECK( entries[1] == "second file" );
+      CHECK( entries[2] == "third" );
+
+      auto args = parser.arguments();
+      REQUIRE( args.argc() == 3 );
+      CHECK( args.argv()[2] == std::string_view( path ));
+    }
+  SUBCASE( "missing file" )
+    {
+      const char* argv[] = { "program", "--files_from", "/nonexistent/parse_options" };
+
+      CHECK_THROWS_WITH( parser.parse( 3, argv ), doctest::Contains( "cannot map argument file" ));
+    }
+
+  unlink( path );
+}
+#endif
+
+#if defined( PARSE_OPTIONS_HAS_POSIX )
+TEST_CASE( "Argument Stream" )
+{
+  struct
+  {
+    bool verbose{false};
+    int integer{0};
+    std::string name;
+  } testOption;
+
+  parse_options::OptionParser parser( "Reads arguments from a pipe" );
+  parser.add( "verbose", "A boolean option", &testOption.verbose );
+  parser.add( "integer", "An integer option", &testOption.integer );
+  parser.add( "name", "A string option", &testOption.name );
+
+  std::vector<std::string> positionals;
+  auto collect = [&]( std::string_view one ) { positionals.emplace_back( one ); };
+
+  int fds[2];
+  REQUIRE( pipe( fds ) == 0 );
+
+  auto feed = [&]( const std::string_view& input ) {
+    REQUIRE( write( fds[1], input.data(), input.size()) == static_cast<ssize_t>( input.size()));
+    close( fds[1] );
+  };
+
+  SUBCASE( "arguments across chunk boundaries" )
+    {
+      feed( std::string_view( "first\0--integer\0" "12345\0--verb\0a_longer_argument\0--name\0tail", 58 ));
+
+      parser.parse_stream( fds[0], collect, '\0', 4 );
+
+      CHECK( testOption.integer == 12345 );
+      CHECK( testOption.verbose == true );
+      CHECK( testOption.name == "tail" );
+      REQUIRE( positionals.size() == 2 );
+      CHECK( positionals[0] == "first" );
+      CHECK( positionals[1] == "a_longer_argument" );
+    }
+  SUBCASE( "newline delimited" )
+    {
+      feed( "one\n--integer\n7\n\ntwo\n" );
+
+      parser.parse_stream( fds[0], collect, '\n', 3 );
+
+      CHECK( testOption.integer == 7 );
+      CHECK( positionals.size() == 2 );
+    }
+  SUBCASE( "missing value at the end" )
+    {
+      feed( "one\n--integer\n" );
+
+      CHECK_THROWS_WITH( parser.parse_stream( fds[0], collect, '\n' ), doctest::Contains( "missing argument" ));
+    }
+  SUBCASE( "unknown option" )
+    {
+      feed( "--unknown\n" );
+
+      CHECK_THROWS_AS( parser.parse_stream( fds[0], collect, '\n' ), std::invalid_argument );
+    }
+  SUBCASE( "no chunk size" )
+    {
+      feed( "--integer\n7\n" );
+
+      CHECK_THROWS_AS( parser.parse_stream( fds[0], collect, '\n', 0 ), std::invalid_argument );
+      CHECK( testOption.integer == 0 );
+    }
+  SUBCASE( "empty value" )
+    {
+      // as parse() does, an empty argument is skipped unless it is the value of an option
+
+      feed( "--name\n\n" );
+
+      CHECK_THROWS_WITH( parser.parse_stream( fds[0], collect, '\n' ), doctest::Contains( "empty value string" ));
+    }
+  SUBCASE( "forgets the argv of an earlier parse" )
+    {
+      {
+        cli_helper ch( "program --integer 3 --name first" );
+        parser.parse( ch.argc(), ch.argv());
+      }
+
+      feed( "--integer\n5\n" );
+      parser.parse_stream( fds[0], collect, '\n' );
+
+      auto args = parser.arguments( "program" );
+
+      REQUIRE( args.argc() == 5 );
+      CHECK( std::string_view( args.argv()[2] ) == "5" );
+      CHECK( std::string_view( args.argv()[4] ) == "first" );
+    }
+
+  close( fds[0] );
+}
+#endif
+
+#if defined( PARSE_OPTIONS_HAS_POSIX )
+TEST_CASE( "Validate Paths" )
+{
+  char dir[] = "/tmp/parse_options_dirXXXXXX";
+  REQUIRE( mkdtemp( dir ) != nullptr );
+
+  std::string file( dir );
+  file.append( "/file" );
+  std::fclose( std::fopen( file.c_str(), "w" ));
+
+  std::string missing( dir );
+  missing.append( "/missing" );
+
+  struct
+  {
+    std::string input;
+    std::string output_dir;
+    std::string unused;
+  } testOption;
+
+  parse_options::OptionParser parser( "Validates paths" );
+  parser.add( "input", "A file to read", &testOption.input );
+  parser.add( "output_dir", "A directory to write to", &testOption.output_dir );
+  parser.add( "unused", "A path that is not given", &testOption.unused );
+
+  parse_options::require_path( parser, "input", parse_options::PathCheck::is_file | parse_options::PathCheck::readable );
+  parse_options::require_path( parser, "output_dir", parse_options::PathCheck::is_dir );
+  parse_options::require_path( parser, "unused", parse_options::PathCheck::exists );
+  parse_options::require_positional_paths( parser, parse_options::PathCheck::exists );
+
+  CHECK_THROWS_AS( parse_options::require_path( parser, "inp", parse_options::PathCheck::exists ), std::invalid_argument );
+
+  SUBCASE( "all valid" )
+    {
+      const char* argv[] = { "program", "--input", file.c_str(), "--output_dir", dir, file.c_str(), dir };
+      parser.parse( 7, argv );
+
+      CHECK( parse_options::validate_paths( parser ).empty());
+      CHECK( parse_options::validate_paths( parser, 1 ).empty());
+    }
+  SUBCASE( "errors per argument" )
+    {
+      const char* argv[] = { "program", "--input", dir, "--output_dir", file.c_str(), file.c_str(), missing.c_str() };
+      parser.parse( 7, argv );
+
+      auto errors = parse_options::validate_paths( parser, 4 );
+
+      REQUIRE( errors.size() == 3 );
+      CHECK( errors[0].argument == "input" );
+      CHECK( errors[0].message == "is not a regular file" );
+      CHECK( errors[1].argument == "output_dir" );
+      CHECK( errors[1].message == "is not a directory" );
+      CHECK( errors[2].argument.empty());
+      CHECK( errors[2].index == 1 );
+      CHECK( errors[2].path == missing );
+      CHECK( errors[2].message == "does not exist" );
+    }
+  SUBCASE( "thread pool and io_uring agree" )
+    {
+      std::vector<const char*> paths = { file.c_str(), dir, missing.c_str() };
+      std::vector<parse_options::PathStatus> status( paths.size());
+
+      parse_options::stat_paths_threaded( paths, status, 2 );
+
+      CHECK( status[0].error == 0 );
+      CHECK( S_ISREG( status[0].mode ));
+      CHECK( S_ISDIR( status[1].mode ));
+      CHECK( status[2].error == ENOENT );
+
+#if defined( PARSE_OPTIONS_HAS_IO_URING ) and defined( STATX_TYPE )
+      std::vector<parse_options::PathStatus> ring_status( paths.size());
+
+      if( parse_options::stat_paths_io_uring( paths, ring_status ))
+        {
+          for( std::size_t ii = 0; ii < paths.size(); ii += 1 )
+            {
+              CHECK( ring_status[ii].error == status[ii].error );
+              CHECK( (ring_status[ii].mode & S_IFMT) == (status[ii].mode & S_IFMT));
+            }
+        }
+#endif
+    }
+
+  unlink( file.c_str());
+  rmdir( dir );
+}
+#endif
+
+#if defined( PARSE_OPTIONS_HAS_POSIX )
+TEST_CASE( "Expand Globs" )
+{
+  char dir[] = "/tmp/parse_options_globXXXXXX";
+  REQUIRE( mkdtemp( dir ) != nullptr );
+
+  std::string base( dir );
+  std::vector<std::string> files = { base + "/b.txt", base + "/a.txt", base + "/.hidden.txt", base + "/c.log",
+                                     base + "/sub/d.txt", base + "/sub/e.txt" };
+  mkdir(( base + "/sub" ).c_str(), 0755 );
+
+  for( const auto& one : files )
+    {
+      std::fclose( std::fopen( one.c_str(), "w" ));
+    }
+
+  struct
+  {
+    std::string config;
+  } testOption;
+
+  parse_options::OptionParser parser( "Expands wildcards" );
+  parser.add( "config", "A configuration file", &testOption.config );
+  parse_options::glob_path( parser, "config" );
+
+  CHECK_THROWS_AS( parse_options::glob_path( parser, "conf" ), std::invalid_argument );
+
+  std::string txt = base + "/*.txt";
+  std::string nested = base + "/*/?.txt";
+  std::string none = base + "/*.none";
+  std::string log = base + "/[c]*";
+
+  SUBCASE( "non-option arguments" )
+    {
+      const char* argv[] = { "program", txt.c_str(), "plain", nested.c_str(), none.c_str(), txt.c_str() };
+      parser.parse( 6, argv );
+      parse_options::expand_globs( parser, 3 );
+
+      auto args = parser.non_option_args();
+      REQUIRE( args.size() == 8 );
+      CHECK( std::string_view( args[0] ) == base + "/a.txt" );
+      CHECK( std::string_view( args[1] ) == base + "/b.txt" );
+      CHECK( std::string_view( args[2] ) == "plain" );
+      CHECK( std::string_view( args[3] ) == base + "/sub/d.txt" );
+      CHECK( std::string_view( args[4] ) == base + "/sub/e.txt" );
+      CHECK( std::string_view( args[5] ) == none );
+      CHECK( std::string_view( args[6] ) == base + "/a.txt" );
+      CHECK( std::string_view( args[7] ) == base + "/b.txt" );
+    }
+  SUBCASE( "one directory read once" )
+    {
+      parse_options::GlobExpander expander( 4 );
+      std::vector<std::string_view> patterns( 16, txt );
+      auto matches = expander.expand( patterns );
+
+      for( const auto& one : matches )
+        {
+          CHECK( one.size() == 2 );
+        }
+
+      CHECK( expander.directories_read() == 1 );
+    }
+  SUBCASE( "option" )
+    {
+      const char* argv[] = { "program", "--config", log.c_str() };
+      parser.parse( 3, argv );
+      parse_options::expand_globs( parser );
+
+      CHECK( testOption.config == base + "/c.log" );
+    }
+  SUBCASE( "option matching more than one path" )
+    {
+      const char* argv[] = { "program", "--config", txt.c_str() };
+      parser.parse( 3, argv );
+
+      CHECK_THROWS_AS( parse_options::expand_globs( parser ), std::invalid_argument );
+    }
+
+  for( const auto& one : files )
+    {
+      unlink( one.c_str());
+    }
+
+  rmdir(( base + "/sub" ).c_str());
+  rmdir( dir );
+}
+#endif
+
+#if defined( PARSE_OPTIONS_HAS_POSIX )
+TEST_CASE( "Prefetch Path" )
+{
+  char path[] = "/tmp/parse_options_prefetchXXXXXX";
+  int tmp = mkstemp( path );
+  REQUIRE( tmp != -1 );
+  REQUIRE( write( tmp, "contents", 8 ) == 8 );
+  close( tmp );
+
+  struct
+  {
+    std::string input_path;
+  } testOption;
+
+  parse_options::PrefetchedFile input;
+
+  parse_options::OptionParser parser( "Prefetches a file" );
+  parser.add( "input_path", "The file to read", &testOption.input_path );
+  parse_options::prefetch_path( parser, "input_path", &input );
+
+  CHECK_THROWS_AS( parse_options::prefetch_path( parser, "input", &input ), std::invalid_argument );
+
+  SUBCASE( "opened when parsed" )
+    {
+      const char* argv[] = { "program", "--input_path", path };
+      parser.parse( 3, argv );
+
+      REQUIRE( input.started());
+      REQUIRE( input.fd() != -1 );
+      CHECK( input.error() == 0 );
+      CHECK( input.path() == path );
+
+      char buffer[16];
+      CHECK( read( input.fd(), buffer, sizeof( buffer )) == 8 );
+      CHECK( std::string( buffer, 8 ) == "contents" );
+
+      int fd = input.release();
+      CHECK( input.fd() == -1 );
+      close( fd );
+    }
+  SUBCASE( "missing file" )
+    {
+      const char* argv[] = { "program", "--input_path", "/nonexistent/parse_options" };
+      parser.parse( 3, argv );
+
+      CHECK( input.fd() == -1 );
+      CHECK( input.error() == ENOENT );
+    }
+  SUBCASE( "not given" )
+    {
+      const char* argv[] = { "program" };
+      parser.parse( 1, argv );
+
+      CHECK( not input.started());
+    }
+
+  unlink( path );
+}
+#endif
+
+TEST_CASE( "Deferred Defaults" )
+{
+  struct
+  {
+    int num_threads{0};
+    std::string host;
+  } testOption;
+
+  int num_computed = 0;
+
+  parse_options::OptionParser parser( "Computes defaults on demand" );
+  parser.add_deferred( "num_threads", "Threads to run, all cores by default", &testOption.num_threads, [&]() {
+    num_computed += 1;
+    return 16;
+  } );
+  parser.add( "host", "A host name", &testOption.host );
+
+  SUBCASE( "given on the command line" )
+    {
+      const char* argv[] = { "program", "--num_threads", "4" };
+      parser.parse( 3, argv );
+
+      CHECK( testOption.num_threads == 4 );
+      CHECK( num_computed == 0 );
+    }
+  SUBCASE( "computed once" )
+    {
+      const char* argv[] = { "program", "--host", "localhost" };
+      parser.parse( 3, argv );
+
+      CHECK( testOption.num_threads == 16 );
+      CHECK( num_computed == 1 );
+
+      const char* argv2[] = { "program", "--num_threads", "2" };
+      parser.parse( 3, argv2 );
+      CHECK( testOption.num_threads == 2 );
+
+      parser.parse( 1, argv );
+      CHECK( testOption.num_threads == 16 );
+      CHECK( num_computed == 1 );
+    }
+  SUBCASE( "written back once computed" )
+    {
+      testOption.num_threads = 99;
+
+      const char* argv[] = { "program", "--host", "localhost" };
+      parser.parse( 3, argv );
+
+      CHECK( parser.arguments().argc() == 3 );
+
+      testOption.num_threads = 2;
+      CHECK( parser.arguments().argc() == 5 );
+    }
+  SUBCASE( "written back until computed" )
+    {
+      const char* argv[] = { "program", "--num_threads", "16" };
+      parser.parse( 3, argv );
+
+      CHECK( parser.arguments().argc() == 3 );
+
+      parser.parse( 1, argv );
+      CHECK( testOption.num_threads == 16 );
+      CHECK( parser.arguments().argc() == 1 );
+    }
+  SUBCASE( "through a cache" )
+    {
+      parse_options::ParseCache cache( 1024 );
+      const char* argv[] = { "program", "--num_threads", "8" };
+      const char* argv2[] = { "program", "--host", "localhost" };
+
+      parser.parse( 3, argv, cache );
+      parser.parse( 3, argv2, cache );
+      parser.parse( 3, argv, cache );
+
+      CHECK( testOption.num_threads == 8 );
+      CHECK( cache.hits() == 1 );
+
+      parser.parse( 3, argv2, cache );
+
+      CHECK( testOption.num_threads == 16 );
+      CHECK( cache.hits() == 2 );
+      CHECK( num_computed == 1 );
+    }
+  SUBCASE( "not computed when the parse fails" )
+    {
+      const char* argv[] = { "program", "--unknown" };
+
+      CHECK_THROWS_AS( parser.parse( 2, argv ), std::invalid_argument );
+      CHECK( num_computed == 0 );
+    }
+  SUBCASE( "switch" )
+    {
+      bool color = false;
+      parser.add_deferred( "color", "Color the output, when on a terminal by default", &color, []() { return false; } );
+
+      const char* argv[] = { "program", "--color", "file" };
+      parser.parse( 3, argv );
+
+      CHECK( color == true );
+      REQUIRE( parser.non_option_args().size() == 1 );
+      CHECK( parser.non_option_args()[0] == "file" );
+
+      parser.parse( 1, argv );
+      CHECK( color == false );
+    }
+}
+
+TEST_CASE( "Derived Options" )
+{
+  struct
+  {
+    int num_threads{4};
+    int memory_mb{1024};
+    std::string name{"default"};
+  } testOption;
+
+  int per_thread_mb = 0;
+  int buffer_kb = 0;
+  std::string label;
+  std::atomic<int> num_per_thread{0}, num_buffer{0}, num_label{0};
+
+  parse_options::OptionParser parser( "Derives settings" );
+  parser.add( "num_threads", "Threads to run", &testOption.num_threads );
+  parser.add( "memory_mb", "The memory limit", &testOption.memory_mb );
+  parser.add( "name", "A name", &testOption.name );
+
+  parse_options::add_derived( parser, "per_thread_mb", &per_thread_mb, { "num_threads", "memory_mb" }, [&]() {
+    num_per_thread += 1;
+    return testOption.memory_mb / testOption.num_threads;
+  } );
+  parse_options::add_derived( parser, "buffer_kb", &buffer_kb, { "per_thread_mb" }, [&]() {
+    num_buffer += 1;
+    return per_thread_mb * 1024 / 8;
+  } );
+  parse_options::add_derived( parser, "label", &label, { "name" }, [&]() {
+    num_label += 1;
+    return testOption.name + "_label";
+  } );
+
+  CHECK_THROWS_AS( parse_options::add_derived( parser, "bad", &buffer_kb, { "missing" }, []() { return 0; } ), std::invalid_argument );
+
+  SUBCASE( "computed after parse" )
+    {
+      const char* argv[] = { "program" };
+      parser.parse( 1, argv );
+
+      CHECK( per_thread_mb == 256 );
+      CHECK( buffer_kb == 32768 );
+      CHECK( label == "default_label" );
+    }
+  SUBCASE( "only what changed" )
+    {
+      const char* argv[] = { "program", "--num_threads", "8" };
+      parser.parse( 3, argv );
+      CHECK( per_thread_mb == 128 );
+
+      const char* argv2[] = { "program", "--name", "other", "--num_threads", "8" };
+      parser.parse( 5, argv2 );
+
+      CHECK( label == "other_label" );
+      CHECK( num_per_thread == 1 );
+      CHECK( num_buffer == 1 );
+      CHECK( num_label == 2 );
+    }
+  SUBCASE( "unchanged value stops the propagation" )
+    {
+      const char* argv[] = { "program", "--num_threads", "2", "--memory_mb", "512" };
+      parser.parse( 5, argv );
+
+      const char* argv2[] = { "program", "--num_threads", "4", "--memory_mb", "1024" };
+      parser.parse( 5, argv2 );
+
+      CHECK( per_thread_mb == 256 );
+      CHECK( num_per_thread == 2 );
+      CHECK( num_buffer == 1 );
+    }
+  SUBCASE( "in parallel" )
+    {
+      parse_options::set_derive_threads( parser, 4 );
+
+      const char* argv[] = { "program", "--num_threads", "2", "--name", "x" };
+      parser.parse( 5, argv );
+
+      CHECK( buffer_kb == 65536 );
+      CHECK( label == "x_label" );
+      CHECK( parse_options::update_derived( parser ) == 0 );
+    }
+  SUBCASE( "from the parser's resource" )
+    {
+      alignas( std::max_align_t ) std::byte buffer[8192];
+      std::pmr::monotonic_buffer_resource pool( buffer, sizeof( buffer ), std::pmr::null_memory_resource());
+
+      num_heap_allocations = 0;
+      count_heap_allocations = true;
+
+      {
+        parse_options::OptionParser pooled( "Derives settings from a memory resource", &pool );
+        pooled.add( "memory_mb", "The memory limit", &testOption.memory_mb );
+
+        parse_options::add_derived( pooled, "per_thread_mb", &per_thread_mb, { "memory_mb" }, [&]() {
+          return testOption.memory_mb / 4;
+        } );
+        parse_options::add_derived( pooled, "buffer_kb", &buffer_kb, { "per_thread_mb" }, [&]() {
+          return per_thread_mb * 1024 / 8;
+        } );
+
+        const char* argv[] = { "program", "--memory_mb", "512" };
+        pooled.parse( 3, argv );
+      }
+
+      count_heap_allocations = false;
+
+      CHECK( num_heap_allocations == 0 );
+      CHECK( buffer_kb == 16384 );
+    }
+}
+
+TEST_CASE( "Completion Script" )
+{
+  struct
+  {
+    bool verbose{false};
+    int integer{0};
+    double real{0.};
+    std::string input;
+  } testOption;
+
+  parse_options::OptionParser parser( "Completes its options" );
+  parser.add( "verbose", "Print [stuff]: it's", &testOption.verbose );
+  parser.add( "integer", "An integer", &testOption.integer );
+  parser.add( "real", "A real", &testOption.real );
+  parser.add( "input", "A file to read", &testOption.input );
+
+  auto contains = []( const std::string& script, const char* text ) {
+    return script.find( text ) != std::string::npos;
+  };
+
+  SUBCASE( "value types" )
+    {
+      const char* argv[] = { "program" };
+      parser.parse( 1, argv );
+
+      std::string bash = parse_options::completion_script( parser, parse_options::CompletionShell::bash, "my-prog" );
+
+      CHECK( contains( bash, "_my_prog_options=( 'input' 'integer' 'real' 'verbose' )\n" ));
+      CHECK( contains( bash, "_my_prog_types=( string int float switch )\n" ));
+      CHECK( contains( bash, "_my_prog_order=( 3 1 2 0 )\n" ));
+      CHECK( contains( bash, "complete -F _my_prog_complete my-prog\n" ));
+    }
+  SUBCASE( "zsh" )
+    {
+      std::string zsh = parse_options::completion_script( parser, parse_options::CompletionShell::zsh, "my-prog" );
+
+      CHECK( contains( zsh, "#compdef my-prog\n" ));
+
+      if constexpr (parse_options::keep_descriptions)
+        {
+          CHECK( contains( zsh, "'--integer[An integer]:int: '" ));
+          CHECK( contains( zsh, "'--input[A file to read]:string:_files'" ));
+          CHECK( contains( zsh, "'--verbose[Print \\[stuff\\]\\: it'\\''s]'" ));
+        }
+      else
+        {
+          CHECK( contains( zsh, "'--integer[]:int: '" ));
+          CHECK( contains( zsh, "'--input[]:string:_files'" ));
+          CHECK( contains( zsh, "'--verbose[]'" ));
+        }
+
+      CHECK( zsh.find( "--input" ) < zsh.find( "--integer" ));
+    }
+  SUBCASE( "fish" )
+    {
+      std::string fish = parse_options::completion_script( parser, parse_options::CompletionShell::fish, "my-prog" );
+
+      if constexpr (parse_options::keep_descriptions)
+        {
+          CHECK( contains( fish, "complete -c my-prog -l 'real' -x -d 'A real'\n" ));
+          CHECK( contains( fish, "complete -c my-prog -l 'input' -r -F -d 'A file to read'\n" ));
+          CHECK( contains( fish, "complete -c my-prog -l 'verbose' -d 'Print [stuff]: it'\\''s'\n" ));
+        }
+      else
+        {
+          CHECK( contains( fish, "complete -c my-prog -l 'real' -x\n" ));
+          CHECK( contains( fish, "complete -c my-prog -l 'input' -r -F\n" ));
+          CHECK( contains( fish, "complete -c my-prog -l 'verbose'\n" ));
+        }
+    }
+}
+
+#if defined( PARSE_OPTIONS_HAS_POSIX )
+TEST_CASE( "Completion Server" )
+{
+  struct
+  {
+    bool verbose{false};
+    int integer{0};
+    std::string input;
+  } testOption;
+
+  parse_options::OptionParser parser( "Answers completion queries" );
+  parser.add( "verbose", "Print semi-useful stuff", &testOption.verbose );
+  parser.add( "integer", "An integer", &testOption.integer );
+  parser.add( "input", "A file to read", &testOption.input );
+
+  CHECK( parse_options::complete( parser, "program", "--in" ) == "--input\n--integer\n" );
+  CHECK( parse_options::complete( parser, "--in", "" ) == "=int\n" );
+  CHECK( parse_options::complete( parser, "--inp", "" ) == "=string\n" );
+  CHECK( parse_options::complete( parser, "--verbose", "-v" ) == "--verbose\n" );
+  CHECK( parse_options::complete( parser, "program", "file" ).empty());
+
+  std::string path = "/tmp/parse_options_completion_" + std::to_string( getpid()) + ".sock";
+
+  parse_options::CompletionServer server( parser, path );
+  std::thread serving( [&]() { server.serve(); } );
+
+  {
+    parse_options::CompletionClient client( path );
+    parse_options::CompletionClient other( path );
+
+    CHECK( client.query( "program", "-" ) == "--input\n--integer\n--verbose\n" );
+    CHECK( other.query( "--integer", "4" ) == "=int\n" );
+    CHECK( client.query( "program", "--x" ).empty());
+    CHECK( client.query( "-i", "" ) == "=int\n" );
+
+    // a plugin adds an option while the server runs
+
+    double ratio = 0;
+    parser.add( "ratio", "Added later", &ratio );
+
+    CHECK( client.query( "program", "--r" ).empty());
+    CHECK( parse_options::complete( parser, "program", "--r" ) == "--ratio\n" );
+
+    server.update( parser );
+
+    CHECK( client.query( "program", "--r" ) == "--ratio\n" );
+    CHECK( other.query( "--ratio", "" ) == "=float\n" );
+  }
+
+  server.stop();
+  serving.join();
+
+  CHECK( server.queries() == 7 );
+}
+#endif
+
+TEST_CASE( "Shared Converters" )
+{
+  // the shared converters have to agree with operator>>, which ValueOption uses without them
+
+  auto stream_result = []( auto* dst, const char* value ) {
+    parse_options::ValueOption<std::remove_pointer_t<decltype( dst )>> option( "option", "", dst );
+
+    try
+      {
+        option.parse( value );
+        return std::string( "ok" );
+      }
+    catch( const std::invalid_argument& e1 )
+      {
+        std::string what( e1.what());
+        return what.substr( 0, what.find( '\n' ));
+      }
+  };
+
+  auto shared_result = []( auto* dst, parse_options::ValueKind kind, const char* value ) {
+    using T = std::remove_pointer_t<decltype( dst )>;
+
+    parse_options::ConvertedValue converted;
+
+    if constexpr (std::is_integral_v<T>)
+      {
+        converted.min = std::numeric_limits<T>::min();
+        converted.max = std::numeric_limits<T>::max();
+      }
+
+    int num_read = parse_options::convert_value( value, kind, converted );
+
+    if( num_read == 1 )
+      {
+        if constexpr (std::is_same_v<T, std::string>)
+          {
+            *dst = converted.string_value;
+          }
+        else if constexpr (std::is_same_v<T, double>)
+          {
+            *dst = converted.double_value;
+          }
+        else if constexpr (std::is_signed_v<T>)
+          {
+            *dst = static_cast<T>( converted.signed_value );
+          }
+        else
+          {
+            *dst = static_cast<T>( converted.unsigned_value );
+          }
+
+        return std::string( "ok" );
+      }
+
+    return std::string( num_read < 0 ? "Error: parsing parameter failed" :
+                        1 < num_read ? "Error: too many arguments" : "Error: empty value string" );
+  };
+
+  const char* values[] = { "", "0", "42", " 42", "42 ", "+42", "-42", "4 2", "42x", "x", " ", "2147483647",
+                           "2147483648", "-2147483648", "-2147483649", "99999999999999999999", "1.5", "-0",
+                           "1e3", "-2.5e-3", "0x1F", "+-1", "1-2", "abc def", "abc", "\tabc" };
+
+  for( const char* value : values )
+    {
+      CAPTURE( value );
+
+      int stream_int = 0, shared_int = 0;
+      CHECK( stream_result( &stream_int, value ) == shared_result( &shared_int, parse_options::ValueKind::signed_integer, value ));
+      CHECK( stream_int == shared_int );
+
+      short stream_short = 0, shared_short = 0;
+      CHECK( stream_result( &stream_short, value ) == shared_result( &shared_short, parse_options::ValueKind::signed_integer, value ));
+
+      double stream_double = 0, shared_double = 0;
+      CHECK( stream_result( &stream_double, value ) == shared_result( &shared_double, parse_options::ValueKind::double_float, value ));
+      CHECK( stream_double == shared_double );
+
+      std::string stream_string, shared_string;
+      CHECK( stream_result( &stream_string, value ) == shared_result( &shared_string, parse_options::ValueKind::string, value ));
+      CHECK( stream_string == shared_string );
+
+      if( not std::strchr( value, '-' ))    // operator>> negates "-1" into an unsigned, the converter rejects it
+        {
+          unsigned stream_unsigned = 0, shared_unsigned = 0;
+          CHECK( stream_result( &stream_unsigned, value ) == shared_result( &shared_unsigned, parse_options::ValueKind::unsigned_integer, value ));
+          CHECK( stream_unsigned == shared_unsigned );
+        }
+    }
+}
+
+TEST_CASE( "Descriptions" )
+{
+  int alpha = 0;
+
+  parse_options::OptionParser parser( "Describes its options" );
+  parser.add( "alpha", PARSE_OPTIONS_DESCRIPTION( "The first option" ), &alpha );
+
+  if constexpr (parse_options::keep_descriptions)
+    {
+      CHECK( parser.usage().find( "The first option" ) != std::string::npos );
+    }
+  else
+    {
+      CHECK( parser.usage() == "OPTIONS:\n\n  --alpha\n" );
+    }
+}
+
+// A user type with neither operator>> nor operator<<, converted only by its value_converter
+
+struct ByteSize
+{
+  unsigned long long bytes{0};
+};
+
+template<>
+struct parse_options::value_converter<ByteSize>
+{
+  static std::errc parse( std::string_view text, ByteSize& value )
+  {
+    unsigned long long number = 0;
+    auto result = std::from_chars( text.data(), text.data() + text.size(), number );
+
+    if( result.ec != std::errc())
+      {
+        return result.ec;
+      }
+
+    std::string_view suffix( result.ptr, text.data() + text.size() - result.ptr );
+    int shift = suffix.empty() ? 0 : suffix == "K" ? 10 : suffix == "M" ? 20 : suffix == "G" ? 30 : -1;
+
+    if( shift < 0 )
+      {
+        return std::errc::invalid_argument;
+      }
+    else if( (number << shift) >> shift != number )
+      {
+        return std::errc::result_out_of_range;
+      }
+
+    value.bytes = number << shift;
+    return std::errc();
+  }
+
+  static void format( const ByteSize& value, std::pmr::string& out )
+  {
+    char buffer[32];
+    auto result = std::to_chars( buffer, buffer + sizeof( buffer ), value.bytes );
+    out.append( buffer, result.ptr );
+  }
+};
+
+// Instantiated in full, as a library would: no member may need operator>> or the shared converters
+
+template class parse_options::ValueOption<ByteSize>;
+
+// A type that can be read but not written, which can still be an option
+
+struct ReadOnly
+{
+  int value{0};
+};
+
+std::istream& operator>>( std::istream& is, ReadOnly& read_only )
+{
+  return is >> read_only.value;
+}
+
+template class parse_options::ValueOption<ReadOnly>;
+
+TEST_CASE( "Value Converters" )
+{
+  static_assert( parse_options::has_value_parser<ByteSize>::value );
+  static_assert( not parse_options::has_value_parser<int>::value );
+
+  ByteSize cache_size;
+  int integer = 0;
+
+  parse_options::OptionParser parser( "Converts a user type" );
+  parser.add( "cache_size", "The size of the cache", &cache_size );
+  parser.add( "integer", "An integer option", &integer );
+
+  auto parse_error = [&]( const char* value ) {
+    const char* argv[] = { "program", "--cache_size", value };
+
+    try
+      {
+        parser.parse( 3, argv );
+        return std::string();
+      }
+    catch( const std::invalid_argument& e1 )
+      {
+        std::string what( e1.what());
+        return what.substr( 0, what.find( '\n' ));
+      }
+  };
+
+  CHECK( parse_error( "4096" ) == "" );
+  CHECK( cache_size.bytes == 4096 );
+
+  CHECK( parse_error( "64M" ) == "" );
+  CHECK( cache_size.bytes == 64ULL << 20 );
+
+  CHECK( parse_error( "64X" ) == "Error: parsing parameter failed" );
+  CHECK( parse_error( " 64" ) == "Error: parsing parameter failed" );
+  CHECK( parse_error( "" ) == "Error: empty value string" );
+  CHECK( parse_error( "99999999999999999999" ) == "Error: value out of range" );
+  CHECK( parse_error( "99999999999G" ) == "Error: value out of range" );
+  CHECK( cache_size.bytes == 64ULL << 20 );   // a failed conversion leaves the value alone
+
+  // the converter also formats the value when the command line is regenerated
+
+  cli_helper ch( "program --cache_size 2K" );
+  parser.parse( ch.argc(), ch.argv());
+  CHECK( cache_size.bytes == 2048 );
+
+  cache_size.bytes = 1 << 10;
+  auto args = parser.arguments();
+
+  REQUIRE( args.argc() == 3 );
+  CHECK( std::string( args.argv()[2] ) == "1024" );
+
+  // a type without operator<< parses, but arguments() cannot write it
+
+  static_assert( not parse_options::is_formattable<ReadOnly>::value );
+
+  ReadOnly read_only;
+  parser.add( "read_only", "A value that cannot be formatted", &read_only );
+
+  cli_helper more( "program --read_only 7" );
+  parser.parse( more.argc(), more.argv());
+
+  CHECK( read_only.value == 7 );
+  CHECK_THROWS_AS( parser.arguments(), std::invalid_argument );
+
+  // nor hash it, so the fingerprint cannot be taken and what is derived from it is always computed
+
+  static_assert( not parse_options::is_hashable<ReadOnly>::value );
+  CHECK_THROWS_AS( parser.fingerprint(), std::invalid_argument );
+
+  int twice = 0;
+  ReadOnly copied;
+  parse_options::add_derived( parser, "twice", &twice, { "read_only" }, [&]() { return 2 * read_only.value; } );
+  parse_options::add_derived( parser, "copied", &copied, { "read_only" }, [&]() { return read_only; } );
+
+  CHECK( parse_options::update_derived( parser ) == 2 );
+  CHECK( parse_options::update_derived( parser ) == 2 );
+  CHECK( twice == 14 );
+  CHECK( copied.value == 7 );
+}